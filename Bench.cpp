@@ -0,0 +1,118 @@
+//
+//  Замер стоимости этапов draw() на воспроизводимой сцене без окна.
+//  Этапы замеряются в одном потоке, отдельно замеряется потайловая отрисовка того же кадра.
+//  Между кадрами сцена продвигается на фиксированный dt, проигрыш игнорируется,
+//  чтобы кубы продолжали появляться на протяжении всего прогона.
+//
+//  game_bench [frames] [seed]
+//
+
+#include "Offscreen.h"
+#include "Game.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+/// @brief Этап кадра и собранные по нему замеры
+struct Stage {
+    const char *name;
+    void (*run)();
+    size_t (*count)(); ///< Число примитивов, рисуемых этапом
+    vector<double> times = {}; ///< Время этапа в каждом кадре, мкс
+    double primitives = 0;
+};
+
+static size_t one() {
+    return 1;
+}
+
+static size_t circles_count() {
+    return game_logic.get_rotator().get_circles().size();
+}
+
+static size_t cubes_count() {
+    return game_logic.get_cube_launcher().shapes.size();
+}
+
+static double percentile(vector<double> sorted, double q) {
+    std::sort(sorted.begin(), sorted.end());
+    size_t idx = size_t(q * double(sorted.size() - 1) + 0.5);
+    return sorted[idx];
+}
+
+static double mean(const vector<double> &values) {
+    double sum = 0;
+    for (double v: values)
+        sum += v;
+    return sum / double(values.size());
+}
+
+int main(int argc, const char **argv) {
+    long frames = argc > 1 ? atol(argv[1]) : 1000;
+    unsigned seed = argc > 2 ? unsigned(atol(argv[2])) : 1;
+    const double dt = 1.0 / 60;
+    if (frames <= 0) {
+        fprintf(stderr, "usage: %s [frames > 0] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    Stage stages[] = {
+            {"damage",       update_damage,     one},
+            {"static layer", draw_static_layer, one},
+            {"rotator fill", draw_circles,      circles_count},
+            {"cube fill",    draw_cubes,        cubes_count},
+            {"scoreboard",   draw_scoreboard,   one},
+            {"bounds",       draw_frame_bounds, one},
+    };
+
+    initialize();
+    game_logic.seed(seed);
+
+    vector<double> totals, tiled;
+    totals.reserve(frames);
+    tiled.reserve(frames);
+    for (auto &stage: stages)
+        stage.times.reserve(frames);
+
+    for (long frame = 0; frame < frames; frame++) {
+        game_logic.actions(dt);
+        game_logic.update_score();
+        publish_snapshot();
+
+        double total = 0;
+        for (auto &stage: stages) {
+            uint64_t start = get_nsec();
+            stage.run();
+            double us = double(get_nsec() - start) * 1e-3;
+            stage.times.push_back(us);
+            stage.primitives += double(stage.count());
+            total += us;
+        }
+        totals.push_back(total);
+
+        // тот же кадр повторно, потайлово на пуле потоков: перерисовка подготовленного кадра идемпотентна
+        uint64_t start = get_nsec();
+        render_frame();
+        tiled.push_back(double(get_nsec() - start) * 1e-3);
+    }
+
+    printf("%ld frames, seed %u, %s pixel kernels, %s collision kernels\n", frames, seed,
+           pixel_kernels().name, collision_kernels().name);
+    printf("%-14s %10s %10s %10s %8s %12s\n", "stage", "mean, us", "p50, us", "p99, us", "count", "per item, us");
+    for (auto &stage: stages) {
+        double count = stage.primitives / double(frames);
+        double m = mean(stage.times);
+        printf("%-14s %10.1f %10.1f %10.1f %8.2f %12.1f\n", stage.name, m,
+               percentile(stage.times, 0.5), percentile(stage.times, 0.99), count, count > 0 ? m / count : 0.0);
+    }
+    double m = mean(totals);
+    printf("%-14s %10.1f %10.1f %10.1f\n", "total", m, percentile(totals, 0.5), percentile(totals, 0.99));
+    printf("%.1f frames/s\n", 1e6 / m);
+    printf("%-14s %10.1f %10.1f %10.1f %8zu threads\n", "tiled render", mean(tiled),
+           percentile(tiled, 0.5), percentile(tiled, 0.99), render_threads());
+
+    finalize();
+
+    return 0;
+}
@@ -14,11 +14,22 @@
 #include <errno.h>
 #include <time.h>
 #include <unistd.h>
-#include <sched.h>
-
-uint32_t buffer[SCREEN_HEIGHT][SCREEN_WIDTH] = {0};
-
-static bool keys[VK__COUNT] = {0};
+#include <atomic>
+#include <memory>
+#include "frame_clock.h"
+#include "pipeline.h"
+#include "profiler.h"
+#ifdef HAVE_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
+
+static uint32_t frame[SCREEN_HEIGHT][SCREEN_WIDTH] = {0};
+uint32_t (*buffer)[SCREEN_WIDTH] = frame;
+
+// written by the event loop, read by act() which may run on the simulation thread
+static std::atomic<bool> keys[VK__COUNT] = {};
 
 static Display *display = NULL;
 static Window window;
@@ -27,7 +38,83 @@ static GC gc = 0;
 static Pixmap pixmap = 0;
 static XEvent event;
 static int screen = 0;
-static bool quit = false;
+static std::atomic<bool> quit(false);
+static bool exposed = false;
+static XImage *image = NULL;
+
+#ifdef HAVE_XSHM
+// MIT-SHM presentation: buffer lives in a segment shared with the X server,
+// so frames are handed over without copying them through the socket
+static XShmSegmentInfo shminfo;
+static bool use_shm = false;
+static int shm_completion_type = -1;
+static bool shm_busy = false; // the server has not finished reading buffer yet
+static bool shm_attach_failed = false;
+
+static int shm_error_handler(Display *, XErrorEvent *) {
+    shm_attach_failed = true;
+    return 0;
+}
+
+static bool create_shm_image() {
+    if (getenv("GAME_NO_SHM") || !XShmQueryExtension(display))
+        return false;
+
+    image = XShmCreateImage(display, visual, 24, ZPixmap, NULL, &shminfo, SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (!image)
+        return false;
+    if (image->bytes_per_line != SCREEN_WIDTH * int(sizeof(uint32_t)) || image->bits_per_pixel != 32) {
+        XDestroyImage(image);
+        image = NULL;
+        return false;
+    }
+
+    shminfo.shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+    if (shminfo.shmid < 0) {
+        XDestroyImage(image);
+        image = NULL;
+        return false;
+    }
+    shminfo.shmaddr = (char *) shmat(shminfo.shmid, NULL, 0);
+    if (shminfo.shmaddr == (char *) -1) {
+        shmctl(shminfo.shmid, IPC_RMID, NULL);
+        XDestroyImage(image);
+        image = NULL;
+        return false;
+    }
+    image->data = shminfo.shmaddr;
+    shminfo.readOnly = False;
+
+    // attaching fails asynchronously on a remote display, so wait for the reply
+    shm_attach_failed = false;
+    XErrorHandler old_handler = XSetErrorHandler(shm_error_handler);
+    Status attached = XShmAttach(display, &shminfo);
+    XSync(display, False);
+    XSetErrorHandler(old_handler);
+    // the segment is freed as soon as both sides detach
+    shmctl(shminfo.shmid, IPC_RMID, NULL);
+
+    if (!attached || shm_attach_failed) {
+        shmdt(shminfo.shmaddr);
+        image->data = NULL;
+        XDestroyImage(image);
+        image = NULL;
+        return false;
+    }
+
+    shm_completion_type = XShmGetEventBase(display) + ShmCompletion;
+    buffer = (uint32_t (*)[SCREEN_WIDTH]) image->data;
+    return true;
+}
+
+static void destroy_shm_image() {
+    XShmDetach(display, &shminfo);
+    XSync(display, False);
+    image->data = NULL;
+    XDestroyImage(image);
+    shmdt(shminfo.shmaddr);
+}
+#endif
 static Atom wmDeleteMessage = 0;
 static XClassHint *classhint = NULL;
 static XWMHints *wmhints = NULL;
@@ -94,13 +181,45 @@ void schedule_quit_game() {
     quit = true;
 }
 
+static void on_event(XEvent &event) {
+    if (event.type == KeyPress)
+        on_key_event(event.xkey, true);
+
+    if (event.type == KeyRelease)
+        on_key_event(event.xkey, false);
+
+    if (event.type == ButtonPress && event.xbutton.button > 0 && event.xbutton.button <= 5)
+        mouse_btn_down[event.xbutton.button - 1] = true;
+
+    if (event.type == ButtonRelease && event.xbutton.button > 0 && event.xbutton.button <= 5)
+        mouse_btn_down[event.xbutton.button - 1] = false;
+
+    if (event.type == ClientMessage && event.xclient.data.l[0] == (int) wmDeleteMessage)
+        quit = true;
+
+    if (event.type == Expose)
+        exposed = true;
+
+#ifdef HAVE_XSHM
+    if (event.type == shm_completion_type)
+        shm_busy = false;
+#endif
+}
+
 uint64_t get_nsec() {
-    timespec ts = {0, 0};
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return uint64_t(ts.tv_sec) * 1000000000 + uint64_t(ts.tv_nsec);
+    return monotonic_nsec();
 }
 
-int main(int, const char **) {
+// the simulation advances in fixed steps of this length regardless of the frame rate
+static const double simulation_tick = 1.0 / 120;
+
+int main(int argc, const char **argv) {
+    // --pipeline: act() of the next frame runs on a separate thread while the current frame is drawn
+    bool pipelined = false;
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "--pipeline") == 0)
+            pipelined = true;
+
     if ((display = XOpenDisplay(getenv("DISPLAY"))) == NULL) {
         fprintf(stderr, "Cannot connect X server: %s\n", strerror(errno));
         exit(1);
@@ -135,35 +254,39 @@ int main(int, const char **) {
 
     XFlush(display);
 
+#ifdef HAVE_XSHM
+    use_shm = create_shm_image();
+#endif
+    if (!image)
+        image = XCreateImage(display, visual, 24, ZPixmap, 0, (char *) buffer, SCREEN_WIDTH, SCREEN_HEIGHT, 32, 0);
+
+    set_simulation_step(float(FixedStepClock(simulation_tick).tick()));
     initialize();
 
-    uint64_t prevTime = get_nsec();
+    std::unique_ptr<SimulationThread> simulation;
+    if (pipelined)
+        simulation.reset(new SimulationThread());
 
-    XImage *image = XCreateImage(display, visual, 24, ZPixmap, 0, (char *) buffer, SCREEN_WIDTH, SCREEN_HEIGHT, 32, 0);
+    // GAME_FPS - frame rate cap, 0 disables it
+    const char *fps = getenv("GAME_FPS");
+    FramePacer pacer(fps ? atof(fps) : 60);
+    // a replay is stepped with the recorded dt, bit-for-bit
+    const float replay_step = get_replay_step();
+    FixedStepClock sim_clock(replay_step > 0 ? replay_step : simulation_tick);
+    const float dt = replay_step > 0 ? replay_step : float(sim_clock.tick());
+    sim_clock.reset(get_nsec());
 
     signal(SIGINT, term_sig_handler);
     signal(SIGTERM, term_sig_handler);
 
     for (;;) {
-        sched_yield();
+        pacer.wait();
+        // frame time excludes the pacing sleep
+        PROFILE_SCOPE("frame");
 
         while (XPending(display)) {
             XNextEvent(display, &event);
-
-            if (event.type == KeyPress)
-                on_key_event(event.xkey, true);
-
-            if (event.type == KeyRelease)
-                on_key_event(event.xkey, false);
-
-            if (event.type == ButtonPress && event.xbutton.button > 0 && event.xbutton.button <= 5)
-                mouse_btn_down[event.xbutton.button - 1] = true;
-
-            if (event.type == ButtonRelease && event.xbutton.button > 0 && event.xbutton.button <= 5)
-                mouse_btn_down[event.xbutton.button - 1] = false;
-
-            if (event.type == ClientMessage && event.xclient.data.l[0] == (int) wmDeleteMessage)
-                quit = true;
+            on_event(event);
 
             Window root_return, child_return;
             int root_x_return, root_y_return;
@@ -176,27 +299,80 @@ int main(int, const char **) {
             }
         }
 
-        uint64_t curTime = get_nsec();
-        if (curTime == prevTime)
-            continue;
-
-        float dt = float(double(curTime - prevTime) * 1e-9);
-        if (dt > 0.1f)
-            dt = 0.1f;
-        act(dt);
-        prevTime = curTime;
+        const float previous_alpha = sim_clock.alpha();
+        int steps = sim_clock.advance(get_nsec());
+        if (simulation) {
+            // the frame shows the state the previous batch ended in, at the alpha it was computed for:
+            // the pipeline adds a frame of latency, but the shown time no longer depends on how far the batch got
+            set_interpolation(previous_alpha);
+            pin_snapshot();
+            simulation->start(dt, steps);
+        } else {
+            for (int i = 0; i < steps && !quit; i++)
+                act(dt);
+            set_interpolation(sim_clock.alpha());
+        }
 
         if (quit)
             break;
 
+#ifdef HAVE_XSHM
+        // the server may still be reading the previous frame from shared memory
+        while (shm_busy) {
+            PROFILE_SCOPE("shm_wait");
+            XNextEvent(display, &event);
+            on_event(event);
+        }
+#endif
+
         draw();
-        XPutImage(display, pixmap, gc, image, 0, 0, 0, 0, image->width, image->height);
-        XCopyArea(display, pixmap, window, gc, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0);
-        XFlush(display);
+
+        // present only the regions changed by draw()
+        const Rect *rects = NULL;
+        int count = get_dirty_rects(&rects);
+        for (int i = 0; i < count; i++) {
+            const Rect &r = rects[i];
+#ifdef HAVE_XSHM
+            if (use_shm) {
+                // completion of the last request means the server is done with the whole frame
+                bool last = i == count - 1;
+                PROFILE_SCOPE("XShmPutImage");
+                XShmPutImage(display, pixmap, gc, image, r.x0, r.y0, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0, last);
+                shm_busy = shm_busy || last;
+            } else
+#endif
+            {
+                PROFILE_SCOPE("XPutImage");
+                XPutImage(display, pixmap, gc, image, r.x0, r.y0, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0);
+            }
+            if (!exposed) {
+                PROFILE_SCOPE("XCopyArea");
+                XCopyArea(display, pixmap, window, gc, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0, r.x0, r.y0);
+            }
+        }
+        if (exposed) {
+            PROFILE_SCOPE("XCopyArea");
+            XCopyArea(display, pixmap, window, gc, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0);
+        }
+        if (count > 0 || exposed) {
+            PROFILE_SCOPE("XFlush");
+            XFlush(display);
+        }
+        exposed = false;
+
+        if (simulation) {
+            PROFILE_SCOPE("simulation_wait");
+            simulation->wait();
+        }
     }
 
+    simulation.reset();
     finalize();
 
+#ifdef HAVE_XSHM
+    if (use_shm)
+        destroy_shm_image();
+#endif
     XFree(classhint);
     XFree(wmhints);
     XFree(sizehints);
@@ -9,8 +9,14 @@
 #define SCREEN_WIDTH 1200
 #define SCREEN_HEIGHT 1200
 
-// backbuffer
-extern uint32_t buffer[SCREEN_HEIGHT][SCREEN_WIDTH];
+// backbuffer, SCREEN_HEIGHT rows of SCREEN_WIDTH pixels
+// (the platform layer may place it in memory shared with the X server)
+extern uint32_t (*buffer)[SCREEN_WIDTH];
+
+// rectangle of buffer, [x0, x1) x [y0, y1)
+struct Rect {
+    int x0, y0, x1, y1;
+};
 
 enum {
     VK_ESCAPE,
@@ -41,4 +47,25 @@ void act(float dt);
 
 void draw();
 
+// fraction of the simulation step elapsed since the last act(), [0, 1];
+// draw() interpolates moving objects between the last two steps by it
+void set_interpolation(float alpha);
+
+// makes the next draw() show the state published by act() so far, not whatever act() publishes meanwhile;
+// called before act() is started on another thread
+void pin_snapshot();
+
+// simulation step the platform layer will pass to act(), must be called before initialize();
+// a recording (GAME_RECORD) stores it in its header
+void set_simulation_step(float dt);
+
+// simulation step of the run being replayed (GAME_REPLAY), 0 - no replay;
+// the platform layer must call act() with exactly this dt
+float get_replay_step();
+// state hash of the replayed run differed from the recorded one
+bool replay_diverged();
+
+// regions of buffer changed by the last draw(), returns their count (0 - frame is unchanged)
+int get_dirty_rects(const Rect **rects);
+
 void schedule_quit_game();
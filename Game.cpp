@@ -1,4 +1,5 @@
 #include "Engine.h"
+#include "Game.h"
 #include <memory.h>
 #include "draw.h"
 #include "mathematics.h"
@@ -6,6 +7,14 @@
 #include "cube_launcher.h"
 #include "game_logic.h"
 #include "scoreboard.h"
+#include "static_layer.h"
+#include "damage.h"
+#include "tiles.h"
+#include "snapshot.h"
+#include "replay.h"
+#include "gif_recorder.h"
+#include "profiler.h"
+#include <random>
 
 //  is_key_pressed(int button_vk_code) - check if a key is pressed,
 //                                       use keycodes (VK_SPACE, VK_RIGHT, VK_LEFT, VK_UP, VK_DOWN, VK_RETURN)
@@ -14,19 +23,69 @@
 //  is_mouse_button_pressed(int button) - check if mouse button is pressed (0 - left button, 1 - right button)
 //  schedule_quit_game() - quit game after act()
 
+// этапы кадра: элементы рисуются этапами draw_* или потайлово в render_frame()
+enum FrameStage {
+    StaticLayerStage,
+    CirclesStage,
+    CubesStage,
+    ScoreboardStage,
+    BoundsStage,
+
+    FrameStage__COUNT
+};
+
+const Vertex<double> orbit_center = {SCREEN_WIDTH / 2.0, SCREEN_HEIGHT / 2.0}; // центр вращения кругов
+const double orbit_R = 280; // радиус вращения кругов
+
+// состояние симуляции, меняется только в act()
 int score = 0;
 GameLogic game_logic;
+unsigned long game_id = 0; // номер текущей игры
+double run_time = 0; // время игры с запуска программы, с
+SnapshotBuffer<Snapshot> snapshots; // передача состояния из act() в draw()
+
+// состояние отрисовки, меняется только в draw()
 Scoreboard scoreboard;
 Circle circle;
+int orbit_dashes = 70; // количество штрихов пунктира орбиты
+StaticLayer static_layer;
+DamageTracker damage;
+unsigned long drawn_version = 0; // версия состояния игры в последнем нарисованном кадре
+unsigned long drawn_game = 0; // номер игры в последнем нарисованном кадре
+int drawn_score = 0; // счет в последнем нарисованном кадре
+float interpolation = 1; // доля шага симуляции, прошедшая после последнего act()
+bool snapshot_pinned = false; // снимок для следующего draw() уже выбран pin_snapshot()
+Snapshot interpolated; // последний снимок, отведенный назад на непрошедшую часть шага
+double drawn_lag = 0; // на сколько секунд назад отведен последний нарисованный кадр
+double drawn_time = 0; // момент игры, показанный последним нарисованным кадром
+vector<DrawItem> frame_items; // элементы текущего кадра в порядке отрисовки
+size_t stage_begin[FrameStage__COUNT + 1] = {0}; // границы этапов кадра в frame_items
+TileRenderer renderer;
 bool is_end = false;
 double wait_restart = 0;
 
-// initialize game data in this function
-void initialize() {
-    double R = 280, r = 40, w = 0.5 * M_PI;
+// запись и воспроизведение ввода: GAME_RECORD=file пишет запуск, GAME_REPLAY=file воспроизводит его
+unsigned run_seed = 0; // зерно запуска, из него выводятся зерна всех игр
+unique_ptr<InputRecorder> recorder;
+unique_ptr<InputReplay> replay;
+float simulation_step = 0; // dt, с которым платформа вызывает act(), 0 - не задан
+bool replay_failed = false;
+unique_ptr<GifRecorder> gif; // GAME_GIF=file - запись кадров в GIF
+
+void publish_snapshot(double step) {
+    Snapshot &snapshot = snapshots.write_slot();
+    game_logic.make_snapshot(snapshot);
+    snapshot.game = game_id;
+    snapshot.step = step;
+    snapshot.time = run_time;
+    snapshots.publish();
+}
+
+// новая игра, вызывается из initialize() и при перезапуске из act()
+static void start_game() {
+    double r = 40, w = 0.5 * M_PI;
     int count = 2; // количество кругов
-    Rotator rotator({SCREEN_WIDTH / 2.0, SCREEN_HEIGHT / 2.0}, R, r, w, count);
-    circle = Circle({SCREEN_WIDTH / 2.0, SCREEN_HEIGHT / 2.0}, R);
+    Rotator rotator(orbit_center, orbit_R, r, w, count);
 
     int cube_limit = 4;
     double bonus_part = 0.4, freeze_part = 0.2, T = 2.5;
@@ -34,29 +93,78 @@ void initialize() {
     double w_min = 2 * M_PI / 5, w_max = 2 * M_PI / 2;
     int size_min = 20, size_max = 40;
     CubeLauncher cube_launcher(cube_limit, bonus_part, freeze_part, T, speed_min, speed_max, w_min, w_max, size_min, size_max);
+    cube_launcher.set_shapes({3, 4, 6}); // треугольники, квадраты и шестиугольники
 
     bool dynamic_difficult = true;
     game_logic = GameLogic(rotator, cube_launcher, dynamic_difficult);
+    game_logic.seed(run_seed + unsigned(game_id));
+
+    game_id++;
+    publish_snapshot();
 }
 
-// this function is called to update game data,
-// dt - time elapsed since the previous update (in seconds)
-void act(float dt) {
-    if (is_key_pressed(VK_ESCAPE))
-        schedule_quit_game();
+// число из переменной окружения env; value не меняется, если переменная не задана
+// false - если значение не число
+static bool env_number(const char *env, double &value) {
+    if (!env)
+        return true;
+    char *end = nullptr;
+    const double parsed = strtod(env, &end);
+    if (end == env || *end != '\0')
+        return false;
+    value = parsed;
+    return true;
+}
+
+// initialize game data in this function
+void initialize() {
+    PROFILE_THREAD("main");
+    run_seed = random_device()();
+    if (const char *path = getenv("GAME_REPLAY")) {
+        replay = make_unique<InputReplay>(path);
+        run_seed = replay->seed();
+        cout << "REPLAY " << path << '\n';
+    } else if (const char *path = getenv("GAME_RECORD")) {
+        recorder = make_unique<InputRecorder>(path, run_seed, simulation_step);
+        cout << "RECORD " << path << '\n';
+    }
+    if (const char *path = getenv("GAME_GIF")) {
+        const char *fps_env = getenv("GAME_GIF_FPS"), *scale_env = getenv("GAME_GIF_SCALE");
+        double fps = 30, scale = 1;
+        if (env_number(fps_env, fps) && env_number(scale_env, scale) &&
+            scale >= 1 && scale <= SCREEN_WIDTH && scale == int(scale) &&
+            GifRecorder::valid_settings(fps, int(scale))) {
+            // воспроизведение записывается без пропуска кадров, и GIF получается одним и тем же
+            gif = make_unique<GifRecorder>(path, fps, int(scale), replay != nullptr);
+            cout << "GIF " << path << '\n';
+        } else {
+            fprintf(stderr, "GIF is not recorded: GAME_GIF_FPS must be in (0, 50], "
+                            "GAME_GIF_SCALE - an integer from 1 to %d\n", SCREEN_WIDTH);
+        }
+    }
+
+    circle = Circle(orbit_center, orbit_R);
+    start_game();
+    static_layer.update(circle, orbit_dashes, background_color, circle_color);
+}
 
+// шаг игры по состоянию клавиш keys
+static void step_game(float dt, const bool keys[VK__COUNT]) {
+    run_time += dt;
     wait_restart -= dt;
-    if (wait_restart < 0 && is_key_pressed(VK_RETURN)) {
+    if (wait_restart < 0 && keys[VK_RETURN]) {
         is_end = false;
         cout << "RESTART GAME\n";
         wait_restart = 0.5;
-        initialize();
+        start_game();
     }
 
-    if (is_end)
+    if (is_end) {
+        publish_snapshot(); // без шага: между шагами кадр не должен сдвигаться
         return;
+    }
 
-    if (is_key_pressed(VK_SPACE))
+    if (keys[VK_SPACE])
         game_logic.change_direction();
 
     game_logic.actions(dt);
@@ -69,29 +177,220 @@ void act(float dt) {
     if (game_logic.get_score() != score) {
         score = game_logic.get_score();
         cout << "Your score is: " << score << '\n';
+        PROFILE_COUNTER("score", score);
     }
+
+    publish_snapshot(is_end ? 0 : dt);
 }
 
-// fill buffer in this function
-// uint32_t buffer[SCREEN_HEIGHT][SCREEN_WIDTH] - is an array of 32-bit colors (8 bits per R, G, B)
-void draw() {
-    // clear backbuffer
-    memset(buffer, 0, SCREEN_HEIGHT * SCREEN_WIDTH * sizeof(uint32_t));
+// хэш состояния после шага: симуляция и ожидание перезапуска
+static uint64_t step_hash() {
+    uint64_t h = game_logic.state_hash();
+    h = hash_bytes(h, is_end);
+    return hash_bytes(h, wait_restart);
+}
+
+// this function is called to update game data,
+// dt - time elapsed since the previous update (in seconds)
+void act(float dt) {
+    PROFILE_SCOPE("act");
+    if (is_key_pressed(VK_ESCAPE))
+        schedule_quit_game();
 
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            set_pixel(x, y, background_color);
+    bool keys[VK__COUNT] = {};
+    for (int vk = 0; vk < VK__COUNT; vk++)
+        keys[vk] = is_key_pressed(vk);
+
+    if (replay) {
+        if (replay_failed || !replay->next(keys)) {
+            if (!replay_failed)
+                cout << "REPLAY FINISHED: " << replay->ticks() << " ticks\n";
+            schedule_quit_game();
+            return;
         }
+        if (dt != replay->step())
+            throw runtime_error("Replay must run with the recorded simulation step");
+    }
+
+    step_game(dt, keys);
+
+    if (recorder)
+        recorder->record(dt, keys, step_hash());
+    if (replay && !replay->check(step_hash())) {
+        cout << "REPLAY DIVERGED at tick " << replay->ticks() - 1 << '\n';
+        replay_failed = true;
     }
+}
+
+void set_simulation_step(float dt) {
+    simulation_step = dt;
+}
+
+float get_replay_step() {
+    return replay ? replay->step() : 0;
+}
 
-    circle.draw_segment_line(circle_color, 70);
-    game_logic.draw();
-    scoreboard.draw_score(game_logic.get_score());
+bool replay_diverged() {
+    return replay_failed;
+}
+
+void set_interpolation(float alpha) {
+    interpolation = min(max(alpha, 0.0f), 1.0f);
+}
 
-    draw_bounds();
+void pin_snapshot() {
+    snapshots.acquire();
+    snapshot_pinned = true;
+}
+
+static void draw_static_item(const DrawItem &item) {
+    static_layer.restore(intersect(item.bounds, clip_rect));
+}
+
+static void draw_score_item(const DrawItem &item) {
+    static_cast<const Scoreboard *>(item.object)->draw();
+}
+
+static void draw_bounds_item(const DrawItem &item) {
+    static_layer.restore_bounds(intersect(item.bounds, clip_rect));
+}
+
+void update_damage() {
+    PROFILE_SCOPE("damage");
+    // фон, орбита и рамка не меняются за игру, поэтому берутся из кэша
+    if (static_layer.update(circle, orbit_dashes, background_color, circle_color))
+        damage.invalidate_all();
+
+    // рисуется последний опубликованный act() снимок, сама игра в draw() не читается;
+    // если act() идет параллельно, снимок выбран заранее, и кадр не зависит от того, насколько act() успел
+    if (!snapshot_pinned)
+        snapshots.acquire();
+    snapshot_pinned = false;
+    const Snapshot &latest = snapshots.read_slot();
+    bool new_game = latest.game != drawn_game;
+    if (new_game)
+        damage.invalidate_all();
+
+    // при фиксированном шаге кадр показывает момент между двумя последними шагами
+    double lag = (1 - double(interpolation)) * latest.step;
+    const Snapshot *shown = &latest;
+    if (lag > 0) {
+        interpolated = latest;
+        interpolated.rewind(lag);
+        shown = &interpolated;
+    }
+    const Snapshot &snapshot = *shown;
+
+    int current_score = snapshot.score;
+    if (new_game || snapshot.version != drawn_version || current_score != drawn_score || lag != drawn_lag) {
+        snapshot.add_damage(damage);
+        if (current_score != drawn_score) {
+            damage.add(scoreboard.bounds(drawn_score));
+            damage.add(scoreboard.bounds(current_score));
+        }
+        damage.commit();
+    } else {
+        damage.skip();
+    }
+    drawn_version = snapshot.version;
+    drawn_game = snapshot.game;
+    drawn_score = current_score;
+    drawn_lag = lag;
+    drawn_time = latest.time - lag;
+
+    auto &dirty = damage.get_dirty();
+    frame_items.clear();
+
+    // изменившиеся области перерисовываются с чистого фона
+    stage_begin[StaticLayerStage] = frame_items.size();
+    for (auto &r: dirty)
+        frame_items.push_back({r, draw_static_item, &static_layer, background_color});
+
+    // круги и кубы целиком лежат в грязных областях любого кадра, в котором сцена изменилась
+    stage_begin[CirclesStage] = frame_items.size();
+    if (!dirty.empty())
+        snapshot.add_circle_items(frame_items);
+
+    stage_begin[CubesStage] = frame_items.size();
+    if (!dirty.empty())
+        snapshot.add_cube_items(frame_items);
+
+    stage_begin[ScoreboardStage] = frame_items.size();
+    scoreboard.update(current_score);
+    Rect box = scoreboard.bounds(current_score);
+    for (auto &r: dirty) {
+        if (is_intersects(r, box)) {
+            frame_items.push_back({box, draw_score_item, &scoreboard, score_color});
+            break;
+        }
+    }
+
+    stage_begin[BoundsStage] = frame_items.size();
+    for (auto &r: dirty)
+        frame_items.push_back({r, draw_bounds_item, &static_layer, bounds_color});
+
+    stage_begin[FrameStage__COUNT] = frame_items.size();
+}
+
+static void draw_stage(FrameStage stage) {
+    for (size_t i = stage_begin[stage]; i < stage_begin[stage + 1]; i++)
+        frame_items[i].draw(frame_items[i]);
+}
+
+void draw_static_layer() {
+    draw_stage(StaticLayerStage);
+}
+
+void draw_circles() {
+    draw_stage(CirclesStage);
+}
+
+void draw_cubes() {
+    draw_stage(CubesStage);
+}
+
+void draw_scoreboard() {
+    draw_stage(ScoreboardStage);
+}
+
+void draw_frame_bounds() {
+    draw_stage(BoundsStage);
+}
+
+void render_frame() {
+    PROFILE_SCOPE("render");
+    renderer.render(frame_items);
+}
+
+size_t render_threads() {
+    return renderer.threads();
+}
+
+int get_dirty_rects(const Rect **rects) {
+    *rects = damage.get_dirty().data();
+    return int(damage.get_dirty().size());
+}
+
+// fill buffer in this function
+// uint32_t buffer[SCREEN_HEIGHT][SCREEN_WIDTH] - is an array of 32-bit colors (8 bits per R, G, B)
+void draw() {
+    PROFILE_SCOPE("draw");
+    update_damage();
+    render_frame();
+    if (gif)
+        gif->capture(drawn_time);
 }
 
 // free game data in this function
 void finalize() {
+    if (recorder)
+        recorder->flush();
+    if (gif) {
+        bool ok = gif->close();
+        cout << "GIF: " << gif->frames() << " frames, " << gif->dropped_frames() << " dropped"
+             << (ok ? "" : ", write error") << '\n';
+        gif.reset();
+    }
+    profile_report();
 }
 
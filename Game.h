@@ -0,0 +1,35 @@
+#pragma once
+
+#include "game_logic.h"
+#include "scoreboard.h"
+
+// Состояние игры из Game.cpp, доступное вспомогательным программам (headless, benchmark)
+extern int score;
+extern GameLogic game_logic;
+extern Scoreboard scoreboard;
+extern Circle circle;
+extern int orbit_dashes;
+extern bool is_end;
+
+// Передать текущее состояние game_logic в draw(), act() делает это сам
+// step - длина только что сделанного шага, по нему draw() интерполирует положения между шагами
+void publish_snapshot(double step = 0);
+
+// Подготовка кадра: грязные области и список элементов
+void update_damage();
+
+// Этапы отрисовки подготовленного кадра в одном потоке, по порядку
+void draw_static_layer();
+
+void draw_circles();
+
+void draw_cubes();
+
+void draw_scoreboard();
+
+void draw_frame_bounds();
+
+// Отрисовка подготовленного кадра по тайлам на пуле потоков, draw() = update_damage() + render_frame()
+void render_frame();
+
+size_t render_threads();
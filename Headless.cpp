@@ -0,0 +1,75 @@
+//
+//  Запуск игры без окна: act()/draw() вызываются с фиксированным dt без ограничения частоты кадров.
+//  Используется для прогонов на машинах без X-сервера и для измерения пропускной способности.
+//
+//  game_headless [--pipeline] [frames] [dt]
+//  --pipeline - act() следующего кадра выполняется в отдельном потоке параллельно с draw() текущего
+//  При воспроизведении (GAME_REPLAY) dt берется из записи, а по умолчанию запись проигрывается до конца;
+//  если состояние разошлось с записанным, код возврата 2.
+//
+
+#include "Offscreen.h"
+#include "pipeline.h"
+#include "profiler.h"
+#include <climits>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, const char **argv) {
+    bool pipelined = false;
+    const char *positional[2] = {NULL, NULL};
+    int positional_count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--pipeline") == 0)
+            pipelined = true;
+        else if (positional_count < 2)
+            positional[positional_count++] = argv[i];
+    }
+
+    long frames = positional[0] ? atol(positional[0]) : 10000;
+    float dt = positional[1] ? float(atof(positional[1])) : 1.0f / 60;
+    if (frames <= 0 || dt <= 0) {
+        fprintf(stderr, "usage: %s [--pipeline] [frames > 0] [dt > 0]\n", argv[0]);
+        return 1;
+    }
+
+    set_simulation_step(dt);
+    initialize();
+    if (get_replay_step() > 0) {
+        dt = get_replay_step();
+        if (!positional[0])
+            frames = LONG_MAX;
+    }
+
+    std::unique_ptr<SimulationThread> simulation;
+    if (pipelined)
+        simulation.reset(new SimulationThread());
+
+    uint64_t start = get_nsec();
+    long frame = 0;
+    for (; frame < frames && !is_quit_scheduled(); frame++) {
+        PROFILE_SCOPE("frame");
+        if (simulation) {
+            // кадр показывает состояние после предыдущего act(), а не то, до которого успел дойти поток симуляции
+            pin_snapshot();
+            simulation->start(dt);
+            draw();
+            PROFILE_SCOPE("simulation_wait");
+            simulation->wait();
+        } else {
+            act(dt);
+            draw();
+        }
+    }
+    double elapsed = double(get_nsec() - start) * 1e-9;
+
+    simulation.reset();
+    finalize();
+
+    printf("frames: %ld, simulated: %.2f s, elapsed: %.3f s, %.1f frames/s\n",
+           frame, frame * double(dt), elapsed, frame / elapsed);
+
+    return replay_diverged() ? 2 : 0;
+}
@@ -0,0 +1,46 @@
+#include "Offscreen.h"
+#include <time.h>
+#include <atomic>
+
+static uint32_t frame[SCREEN_HEIGHT][SCREEN_WIDTH] = {0};
+uint32_t (*buffer)[SCREEN_WIDTH] = frame;
+
+static std::atomic<bool> keys[VK__COUNT] = {};
+static std::atomic<bool> quit(false);
+
+void set_key_pressed(int button_vk_code, bool pressed) {
+    if (unsigned(button_vk_code) < VK__COUNT)
+        keys[button_vk_code] = pressed;
+}
+
+bool is_key_pressed(int button_vk_code) {
+    if (unsigned(button_vk_code) >= VK__COUNT)
+        return false;
+    return keys[button_vk_code];
+}
+
+bool is_mouse_button_pressed(int) {
+    return false;
+}
+
+int get_cursor_x() {
+    return 0;
+}
+
+int get_cursor_y() {
+    return 0;
+}
+
+void schedule_quit_game() {
+    quit = true;
+}
+
+bool is_quit_scheduled() {
+    return quit;
+}
+
+uint64_t get_nsec() {
+    timespec ts = {0, 0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + uint64_t(ts.tv_nsec);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+//
+//  Платформенный слой без окна для game_headless и game_bench:
+//  кадр рисуется в buffer, а состояние клавиш задаёт сама программа.
+//
+
+#include "Engine.h"
+
+void set_key_pressed(int button_vk_code, bool pressed);
+
+bool is_quit_scheduled();
+
+uint64_t get_nsec();
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+using namespace std;
+
+/// @brief Арена временных буферов одного шага или кадра
+/// @details Память выдается сдвигом указателя внутри больших блоков и не освобождается поштучно:
+/// reset() разом возвращает всю арену, блоки остаются за ней. После первых кадров блоков хватает
+/// на самый тяжелый кадр, и выделение памяти из кучи больше не происходит. Копия арены пуста:
+/// временные буферы не переживают шаг, и копировать их нечего.
+class FrameArena {
+    static constexpr size_t block_size = 64 * 1024;
+
+    struct Block {
+        unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    vector<Block> blocks;
+    size_t current = 0; ///< Блок, из которого идет выделение
+    size_t offset = 0; ///< Занято байт в текущем блоке
+
+public:
+
+    FrameArena() = default;
+
+    FrameArena(const FrameArena &) {}
+
+    FrameArena &operator=(const FrameArena &) {
+        reset();
+        return *this;
+    }
+
+    /// @brief Выделить size байт с выравниванием align
+    void *allocate(size_t size, size_t align) {
+        for (; current < blocks.size(); current++, offset = 0) {
+            Block &block = blocks[current];
+            uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+            size_t begin = (base + offset + align - 1) / align * align - base;
+            if (begin + size <= block.size) {
+                offset = begin + size;
+                return block.data.get() + begin;
+            }
+        }
+
+        // new[] выравнивает по alignof(max_align_t), больших выравниваний буферам не нужно
+        size_t bytes = max(block_size, size + align);
+        blocks.push_back({unique_ptr<unsigned char[]>(new unsigned char[bytes]), bytes});
+        current = blocks.size() - 1;
+        offset = 0;
+        return allocate(size, align);
+    }
+
+    /// @brief Освободить все выделенное, сохранив блоки
+    void reset() {
+        current = 0;
+        offset = 0;
+    }
+
+    /// @brief Сколько байт арена держит в блоках
+    size_t capacity() const {
+        size_t total = 0;
+        for (auto &block: blocks)
+            total += block.size;
+        return total;
+    }
+};
+
+/// @brief Аллокатор стандартных контейнеров поверх FrameArena
+/// @details deallocate ничего не делает: память вернется при reset() арены. Контейнер нельзя
+/// использовать после reset() своей арены. Без арены аллокатор работает как обычный new/delete.
+template<class T>
+class ArenaAllocator {
+    template<class U>
+    friend class ArenaAllocator;
+
+    FrameArena *arena = nullptr;
+
+public:
+
+    using value_type = T;
+    using propagate_on_container_copy_assignment = true_type;
+    using propagate_on_container_move_assignment = true_type;
+    using propagate_on_container_swap = true_type;
+
+    ArenaAllocator() = default;
+
+    explicit ArenaAllocator(FrameArena &arena) : arena(&arena) {}
+
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) {
+        if (!arena)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t) {
+        if (!arena)
+            ::operator delete(p);
+    }
+
+    template<class U>
+    bool operator==(const ArenaAllocator<U> &other) const {
+        return arena == other.arena;
+    }
+
+    template<class U>
+    bool operator!=(const ArenaAllocator<U> &other) const {
+        return arena != other.arena;
+    }
+};
+
+/// @brief Вектор, память которого живет до reset() арены
+template<class T>
+using FrameVector = vector<T, ArenaAllocator<T>>;
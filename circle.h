@@ -9,6 +9,19 @@ public:
     Vertex<double> center; ///< Центр круга
     Vertex<double> u; ///< Скорость круга
 
+private:
+
+    /// @brief Пунктир, построенный draw_segment_line, для центра, радиуса и числа штрихов
+    struct DashCache {
+        Vertex<double> center;
+        double r = -1;
+        int count = 0;
+        vector<PixelRun> runs; ///< Пиксели штрихов в пределах изображения
+    };
+    mutable DashCache dashes;
+
+public:
+
     Circle() = default;
 
     Circle(const Vertex<double> &center, double r, const Vertex<double> &u = {0, 0}) : u(u), center(center), r(r) {}
@@ -54,6 +67,14 @@ public:
     /// @param phi1, phi2 значение двух углов, которые задают радиус-вектора от центра окружности до
     /// крайних точек дуги. Дуга строится против часовой стрелки.
     void draw_with_bezier(const Color &color, double phi1 = 0, double phi2 = 2 * M_PI) const {
+        walk_with_bezier(phi1, phi2, [&](int x, int y) {
+            set_pixel(x, y, color);
+        });
+    }
+
+    /// @brief Обход пикселей дуги, которую рисует draw_with_bezier: plot(x, y)
+    template<class Plot>
+    void walk_with_bezier(double phi1, double phi2, Plot &&plot) const {
         double step = M_PI / 4;
         while (phi1 < phi2) {
             double R = r / sin(M_PI / 2 - step / 2);
@@ -64,26 +85,51 @@ public:
                 Vertex<double> pt = center + Vertex{R * cos(phi1 + step / 2), R * sin(phi1 + step / 2)};
                 Vertex<double> p2 = p1 + (pt - p1) * F;
                 Vertex<double> p3 = p4 + (pt - p4) * F;
-                draw_bezier_curve({p1, p2, p3, p4}, color);
+                const Vertex<double> arc[4] = {p1, p2, p3, p4};
+                walk_bezier_curve(arc, 4, plot);
                 phi1 += step;
             }
             step = phi2 - phi1;
         }
     }
 
+    /// @brief Прямоугольник, который занимает круг на экране
+    Rect bounds() const {
+        int cx = round_to_int(center.x), cy = round_to_int(center.y), R = int(r);
+        return {cx - R, cy - R, cx + R + 1, cy + R + 1};
+    }
+
     /// @brief Заливка круга
     void fill(const Color &color) const {
-        draw_with_bezier(color);
-        fill_figure(to_int_point(center), color);
+        fill_disk(round_to_int(center.x), round_to_int(center.y), int(r), color);
+    }
+
+    /// @brief Отрисовка круга как элемента кадра
+    static void draw_item(const DrawItem &item) {
+        static_cast<const Circle *>(item.object)->fill(item.color);
     }
 
     /// @brief Отрисовка границы круга прерывистой линией
+    /// @details Пиксели штрихов строятся один раз и запоминаются, пока не изменятся центр, радиус или число штрихов.
     void draw_segment_line(const Color &color, int count) const {
-        double delta = 2 * M_PI / count;
-        for (int i = 0; i < count; i++) {
-            double phi = delta * i;
-            draw_with_bezier(color, phi, phi + delta / 2);
+        if (dashes.r != r || dashes.center != center || dashes.count != count) {
+            static thread_local vector<Vertex<int>> pixels;
+            pixels.clear();
+            double delta = 2 * M_PI / count;
+            for (int i = 0; i < count; i++) {
+                double phi = delta * i;
+                walk_with_bezier(phi, phi + delta / 2, [&](int x, int y) {
+                    if (is_point_in_image(x, y))
+                        pixels.push_back({x, y});
+                });
+            }
+            pixels_to_runs(pixels, dashes.runs);
+            dashes.center = center;
+            dashes.r = r;
+            dashes.count = count;
         }
+
+        fill_runs(dashes.runs, color);
     }
 
     ~Circle() = default;
@@ -0,0 +1,130 @@
+#include "collision.h"
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// Для каждой пары: квадрат расстояния от центра круга до ближайшей точки каждого ребра,
+// и знак векторного произведения ребра на направление к центру. Центр внутри многоугольника,
+// если все знаки совпадают. Скалярный и векторный варианты выполняют одни и те же операции
+// в одном порядке, поэтому дают одинаковый результат. Ядра собираются для каждого числа вершин N,
+// поэтому цикл по ребрам развертывается при компиляции.
+
+/// @brief Вызвать f(integral_constant<int, N>()) для N = vertices
+template<class F>
+static void with_vertices(int vertices, F &&f) {
+    switch (vertices) {
+        case 3: f(integral_constant<int, 3>()); break;
+        case 4: f(integral_constant<int, 4>()); break;
+        case 5: f(integral_constant<int, 5>()); break;
+        case 6: f(integral_constant<int, 6>()); break;
+        case 7: f(integral_constant<int, 7>()); break;
+        case 8: f(integral_constant<int, 8>()); break;
+        default: throw runtime_error("Polygon must have from 3 to 8 vertices");
+    }
+}
+
+template<int n>
+static void circle_polygon_range(const CirclePolygonView &pairs, size_t from, size_t to, uint8_t *hit) {
+    for (size_t i = from; i < to; i++) {
+        const double cx = pairs.cx[i], cy = pairs.cy[i];
+        double min_d2 = pairs.r2[i] + 1;
+        bool all_pos = true, all_neg = true;
+        for (int k = 0; k < n; k++) {
+            const int next = k + 1 < n ? k + 1 : 0;
+            const double ax = pairs.px[k][i], ay = pairs.py[k][i];
+            const double ex = pairs.px[next][i] - ax, ey = pairs.py[next][i] - ay;
+            const double dx = cx - ax, dy = cy - ay;
+
+            double t = (dx * ex + dy * ey) / (ex * ex + ey * ey);
+            t = t > 0 ? t : 0;
+            t = t < 1 ? t : 1;
+            const double qx = dx - t * ex, qy = dy - t * ey;
+            const double d2 = qx * qx + qy * qy;
+            min_d2 = min_d2 < d2 ? min_d2 : d2;
+
+            const double cross = ex * dy - ey * dx;
+            all_pos = all_pos && cross >= 0;
+            all_neg = all_neg && cross <= 0;
+        }
+        hit[i] = uint8_t(all_pos || all_neg || min_d2 <= pairs.r2[i]);
+    }
+}
+
+static void circle_polygon_scalar(const CirclePolygonView &pairs, uint8_t *hit) {
+    with_vertices(pairs.vertices, [&](auto n) {
+        circle_polygon_range<decltype(n)::value>(pairs, 0, pairs.size(), hit);
+    });
+}
+
+#ifdef HAVE_X86_KERNELS
+
+template<int n>
+__attribute__((target("avx2")))
+static void circle_polygon_avx2_n(const CirclePolygonView &pairs, uint8_t *hit) {
+    const size_t count = pairs.size();
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d cx = _mm256_loadu_pd(&pairs.cx[i]), cy = _mm256_loadu_pd(&pairs.cy[i]);
+        const __m256d r2 = _mm256_loadu_pd(&pairs.r2[i]);
+        __m256d min_d2 = _mm256_add_pd(r2, one);
+        __m256d all_pos = _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), all_neg = all_pos;
+        for (int k = 0; k < n; k++) {
+            const int next = k + 1 < n ? k + 1 : 0;
+            const __m256d ax = _mm256_loadu_pd(&pairs.px[k][i]), ay = _mm256_loadu_pd(&pairs.py[k][i]);
+            const __m256d ex = _mm256_sub_pd(_mm256_loadu_pd(&pairs.px[next][i]), ax);
+            const __m256d ey = _mm256_sub_pd(_mm256_loadu_pd(&pairs.py[next][i]), ay);
+            const __m256d dx = _mm256_sub_pd(cx, ax), dy = _mm256_sub_pd(cy, ay);
+
+            __m256d t = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(dx, ex), _mm256_mul_pd(dy, ey)),
+                                      _mm256_add_pd(_mm256_mul_pd(ex, ex), _mm256_mul_pd(ey, ey)));
+            t = _mm256_max_pd(t, zero);
+            t = _mm256_min_pd(t, one);
+            const __m256d qx = _mm256_sub_pd(dx, _mm256_mul_pd(t, ex));
+            const __m256d qy = _mm256_sub_pd(dy, _mm256_mul_pd(t, ey));
+            min_d2 = _mm256_min_pd(min_d2, _mm256_add_pd(_mm256_mul_pd(qx, qx), _mm256_mul_pd(qy, qy)));
+
+            const __m256d cross = _mm256_sub_pd(_mm256_mul_pd(ex, dy), _mm256_mul_pd(ey, dx));
+            all_pos = _mm256_and_pd(all_pos, _mm256_cmp_pd(cross, zero, _CMP_GE_OQ));
+            all_neg = _mm256_and_pd(all_neg, _mm256_cmp_pd(cross, zero, _CMP_LE_OQ));
+        }
+        const __m256d result = _mm256_or_pd(_mm256_or_pd(all_pos, all_neg), _mm256_cmp_pd(min_d2, r2, _CMP_LE_OQ));
+        const int mask = _mm256_movemask_pd(result);
+        for (int lane = 0; lane < 4; lane++)
+            hit[i + lane] = uint8_t((mask >> lane) & 1);
+    }
+    circle_polygon_range<n>(pairs, i, count, hit);
+}
+
+static void circle_polygon_avx2(const CirclePolygonView &pairs, uint8_t *hit) {
+    with_vertices(pairs.vertices, [&](auto n) { circle_polygon_avx2_n<decltype(n)::value>(pairs, hit); });
+}
+
+#endif
+
+static const CollisionKernels scalar_kernels = {"scalar", circle_polygon_scalar};
+#ifdef HAVE_X86_KERNELS
+static const CollisionKernels avx2_kernels = {"avx2", circle_polygon_avx2};
+#endif
+
+static const CollisionKernels &select_kernels() {
+    const char *forced = getenv("GAME_KERNELS");
+
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    bool allowed = !forced || strcmp(forced, "avx2") == 0 || strcmp(forced, "avx512") == 0;
+    if (allowed && __builtin_cpu_supports("avx2"))
+        return avx2_kernels;
+#endif
+    return scalar_kernels;
+}
+
+const CollisionKernels &collision_kernels() {
+    static const CollisionKernels &selected = select_kernels();
+    return selected;
+}
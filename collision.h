@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+/// @brief Пакет пар "круг - выпуклый многоугольник", как его видят ядра: указатели на массивы полей
+struct CirclePolygonView {
+    static const int max_vertices = 8;
+
+    int vertices = 4; ///< Число вершин каждого многоугольника
+    size_t count = 0; ///< Число пар
+    const double *cx = nullptr, *cy = nullptr; ///< Центры кругов
+    const double *r2 = nullptr; ///< Квадраты радиусов кругов
+    const double *px[max_vertices] = {}, *py[max_vertices] = {}; ///< k-е вершины многоугольников
+
+    size_t size() const {
+        return count;
+    }
+};
+
+/// @brief Пары "круг - выпуклый многоугольник" для пакетной проверки пересечений
+/// @details Каждое поле хранится отдельным массивом, чтобы ядро проверяло несколько пар за одну инструкцию.
+/// У всех многоугольников пакета одинаковое число вершин, обход в любом направлении.
+/// Alloc задает, откуда берется память массивов, например ArenaAllocator для пакета на один шаг.
+template<class Alloc = allocator<double>>
+struct BasicCirclePolygonPairs {
+    static const int max_vertices = CirclePolygonView::max_vertices;
+    using Column = vector<double, typename allocator_traits<Alloc>::template rebind_alloc<double>>;
+
+    int vertices = 4; ///< Число вершин каждого многоугольника
+    Column cx, cy; ///< Центры кругов
+    Column r2; ///< Квадраты радиусов кругов
+    Column px[max_vertices], py[max_vertices]; ///< k-е вершины многоугольников
+
+    explicit BasicCirclePolygonPairs(const Alloc &alloc = Alloc()) : cx(alloc), cy(alloc), r2(alloc) {
+        for (int k = 0; k < max_vertices; k++) {
+            px[k] = Column(alloc);
+            py[k] = Column(alloc);
+        }
+    }
+
+    /// @brief Очистить пакет, сохранив выделенную память
+    void clear(int polygon_vertices) {
+        if (polygon_vertices < 3 || polygon_vertices > max_vertices)
+            throw runtime_error("Polygon must have from 3 to 8 vertices");
+        vertices = polygon_vertices;
+        cx.clear();
+        cy.clear();
+        r2.clear();
+        for (int k = 0; k < max_vertices; k++) {
+            px[k].clear();
+            py[k].clear();
+        }
+    }
+
+    /// @brief Зарезервировать память под n пар
+    void reserve(size_t n) {
+        cx.reserve(n);
+        cy.reserve(n);
+        r2.reserve(n);
+        for (int k = 0; k < vertices; k++) {
+            px[k].reserve(n);
+            py[k].reserve(n);
+        }
+    }
+
+    size_t size() const {
+        return cx.size();
+    }
+
+    /// @brief Добавить пару
+    /// @param points Вершины многоугольника, не меньше vertices штук
+    template<class Points>
+    void add(double x, double y, double r, const Points &points) {
+        cx.push_back(x);
+        cy.push_back(y);
+        r2.push_back(r * r);
+        for (int k = 0; k < vertices; k++) {
+            px[k].push_back(points[k].x);
+            py[k].push_back(points[k].y);
+        }
+    }
+
+    /// @brief Пакет для ядер; действителен, пока пакет не изменится
+    CirclePolygonView view() const {
+        CirclePolygonView v;
+        v.vertices = vertices;
+        v.count = size();
+        v.cx = cx.data();
+        v.cy = cy.data();
+        v.r2 = r2.data();
+        for (int k = 0; k < vertices; k++) {
+            v.px[k] = px[k].data();
+            v.py[k] = py[k].data();
+        }
+        return v;
+    }
+};
+
+using CirclePolygonPairs = BasicCirclePolygonPairs<>;
+
+/// @brief Квадрат расстояния от точки (x, y) до выпуклого многоугольника из N вершин, 0 - если точка внутри
+/// @details Те же вычисления, что и в CollisionKernels::circle_polygon, для одной пары.
+template<int N, class Points>
+inline double polygon_distance2(double x, double y, const Points &points) {
+    double min_d2 = INFINITY;
+    bool all_pos = true, all_neg = true;
+    for (int k = 0; k < N; k++) {
+        const int next = k + 1 < N ? k + 1 : 0;
+        const double ax = points[k].x, ay = points[k].y;
+        const double ex = points[next].x - ax, ey = points[next].y - ay;
+        const double dx = x - ax, dy = y - ay;
+
+        double t = (dx * ex + dy * ey) / (ex * ex + ey * ey);
+        t = t > 0 ? t : 0;
+        t = t < 1 ? t : 1;
+        const double qx = dx - t * ex, qy = dy - t * ey;
+        const double d2 = qx * qx + qy * qy;
+        min_d2 = min_d2 < d2 ? min_d2 : d2;
+
+        const double cross = ex * dy - ey * dx;
+        all_pos = all_pos && cross >= 0;
+        all_neg = all_neg && cross <= 0;
+    }
+    return all_pos || all_neg ? 0 : min_d2;
+}
+
+/// @brief Ядра пакетной проверки пересечений
+/// @details Вариант выбирается так же, как PixelKernels: по CPUID, либо переменной окружения GAME_KERNELS
+/// (scalar и sse2 выбирают скалярный вариант, avx2 и avx512 - вариант для AVX2).
+struct CollisionKernels {
+    const char *name;
+
+    /// @brief hit[i] = 1, если i-й круг и i-й многоугольник имеют общую точку, включая вложение одного в другой
+    void (*circle_polygon)(const CirclePolygonView &pairs, uint8_t *hit);
+};
+
+/// @brief Набор ядер, выбранный для текущего процессора
+const CollisionKernels &collision_kernels();
@@ -1,10 +1,21 @@
 #pragma once
 
-#include "cube.h"
+#include "cube_pool.h"
 #include "color_settings.h"
-#include <list>
 #include <random>
 
+/// @brief Цвет куба заданного типа
+inline const Color &get_cube_color(CubeType type) {
+    switch (type) {
+        case Bonus:
+            return bonus_color;
+        case Freeze:
+            return freeze_color;
+        default:
+            return projectile_color;
+    }
+}
+
 ///@brief Класс, предназначенный для запуска и контроля кубов
 class CubeLauncher {
     int cube_limit = 4; ///< Количество кубиков одновременно на экране
@@ -21,11 +32,13 @@ class CubeLauncher {
     std::uniform_real_distribution<double> target_y_generator;
     std::uniform_int_distribution<int> size_generator;
     std::uniform_int_distribution<int> wall_generator;
-    std::default_random_engine re;
+    std::default_random_engine re; ///< Генераторы задаются seed(), без него последовательность кубов одна и та же
     std::default_random_engine re_cube_type;
+    std::default_random_engine re_shape;
+    vector<int> shape_vertices = {4}; ///< Формы новых кубов - числа вершин, выбираются равновероятно
 
 public:
-    list <Cube> cubes; ///< Текущие кубы
+    ShapePools shapes; ///< Текущие кубы всех форм
 
     CubeLauncher() = default;
 
@@ -61,10 +74,6 @@ public:
         if (size_max < size_min)
             throw runtime_error("The maximum size must be greater than the minimum");
 
-        std::random_device rd;
-        re = default_random_engine(rd());
-        re_cube_type = default_random_engine(rd());
-
         type_generator = std::uniform_real_distribution<double>(0, 1);
         speed_generator = std::uniform_real_distribution<double>(speed_min, speed_max);
         angular_speed_generator = std::uniform_real_distribution<double>(w_min, w_max);
@@ -73,51 +82,54 @@ public:
         target_y_generator = std::uniform_real_distribution<double>(0.3 * SCREEN_HEIGHT, 0.7 * SCREEN_HEIGHT);
         size_generator = std::uniform_int_distribution<int>(size_min, size_max);
         wall_generator = std::uniform_int_distribution<int>(0, 3);
+        shapes.reserve(cube_limit);
     }
 
-private:
-
-    /// @brief Проверка наличия куба на изображении
-    bool check_cube_in_image(const vector<Vertex<double>> &points) {
-        for (auto &p: points)
-            if (!is_point_in_image(to_int_point(p)))
-                return false;
-
-        return true;
+    /// @brief Задать формы новых кубов
+    /// @param vertices Числа вершин: 3 - треугольник, 4 - квадрат, 6 - шестиугольник
+    void set_shapes(const vector<int> &vertices) {
+        if (vertices.empty())
+            throw runtime_error("At least one cube shape must be set");
+        for (int n: vertices)
+            if (n != 3 && n != 4 && n != 6)
+                throw runtime_error("Cube must have 3, 4 or 6 vertices");
+        shape_vertices = vertices;
     }
 
-public:
-
     /// @brief Двигает все кубы и удаляет вылетевшие за границу
     void move(double dt) {
-        auto it = cubes.begin();
-        while (it != cubes.end()) {
-            it->move(dt);
-            it->rotate(dt);
-            while (it != cubes.end() && !check_cube_in_image(it->points)) {
-                auto cur = it;
-                ++it;
-                cubes.erase(cur);
-            }
-            ++it;
-        }
+        shapes.for_each([&](auto &cubes, int) {
+            cubes.move(dt);
+            // с конца: на место удаленного встает уже проверенный куб
+            for (size_t i = cubes.size(); i-- > 0;)
+                if (!cubes.is_in_image(i))
+                    cubes.remove_at(i);
+        });
     }
 
     /// @brief Отрисовка кубов
-    void draw() {
-        for (auto &cube: cubes) {
-            switch (cube.type) {
-                case Projectile:
-                    cube.fill(projectile_color, true);
-                    break;
-                case Bonus:
-                    cube.fill(bonus_color, true);
-                    break;
-                case Freeze:
-                    cube.fill(freeze_color, true);
-                    break;
-            }
-        }
+    void draw() const {
+        shapes.for_each([&](auto &cubes, int) {
+            for (size_t i = 0; i < cubes.size(); i++)
+                cubes.fill(i, get_cube_color(cubes.type(i)));
+        });
+    }
+
+
+    /// @brief Задать зерно генераторов случайных чисел, чтобы последовательность кубов была воспроизводимой
+    void seed(unsigned value) {
+        re.seed(value);
+        re_cube_type.seed(value + 1);
+        re_shape.seed(value + 2);
+    }
+
+    /// @brief Продолжить хэш h состоянием запуска кубов и самими кубами
+    uint64_t hash(uint64_t h) const {
+        h = hash_bytes(h, time);
+        h = hash_bytes(h, T);
+        h = hash_bytes(h, speed_generator.min());
+        h = hash_bytes(h, speed_generator.max());
+        return shapes.hash(h);
     }
 
     /// @brief Ускорить кубы в alpha раз
@@ -133,7 +145,7 @@ public:
     /// @brief Генерация куба
     void generate(double dt) {
         time -= dt;
-        if (time > 0 || cubes.size() >= cube_limit)
+        if (time > 0 || shapes.size() >= cube_limit)
             return;
         time = T;
 
@@ -170,7 +182,11 @@ public:
         } else if (bonus_part + freeze_part > type_val) {
             type = CubeType::Freeze;
         }
-        cubes.emplace_back(from, size, velocity, w, type);
+        int vertices = shape_vertices[0];
+        if (shape_vertices.size() > 1)
+            vertices = shape_vertices[uniform_int_distribution<size_t>(0, shape_vertices.size() - 1)(re_shape)];
+        shapes.reserve(cube_limit); // копия лаунчера не сохраняет зарезервированную память
+        shapes.spawn(vertices, from, size, velocity, w, type);
     }
 
     ~CubeLauncher() = default;
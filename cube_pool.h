@@ -0,0 +1,347 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "cube.h"
+
+/// @brief Стабильный идентификатор куба в CubePool
+/// @details Остается действительным, пока куб не удален, независимо от перестановок внутри пула.
+struct CubeHandle {
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+/// @brief Вершины одного куба
+using CubePoints = PolygonPoints<4>;
+
+/// @brief Непрерывный пул многоугольников из N вершин
+/// @details Каждое поле хранится отдельным массивом, k-я вершина всех многоугольников - тоже, поэтому движение
+/// и проверки проходят по памяти подряд, а циклы по вершинам развернуты при компиляции. Живые многоугольники
+/// занимают индексы [0, size()), удаление переносит на место удаленного последний, так что индексы
+/// не стабильны - для ссылок служит CubeHandle.
+template<int N>
+class PolygonPool {
+    static_assert(N >= 3 && N <= 8, "Polygon in pool must have from 3 to 8 vertices");
+
+    vector<double> cx, cy; ///< Центры
+    vector<double> ux, uy; ///< Скорости
+    vector<double> w; ///< Угловые скорости
+    vector<double> radius; ///< Радиусы описанных окружностей
+    vector<double> rc, rs; ///< Поворот от начального положения: косинус и синус угла
+    vector<CubeType> types; ///< Типы
+    vector<double> px[N], py[N]; ///< k-е вершины всех многоугольников, вычисляются по центру и повороту
+
+    /// @brief Ячейка таблицы идентификаторов
+    struct Slot {
+        uint32_t index; ///< Индекс куба в массивах или следующая свободная ячейка
+        uint32_t generation; ///< Увеличивается при каждом удалении куба из ячейки
+    };
+    vector<Slot> slots;
+    vector<uint32_t> owners; ///< Ячейка таблицы идентификаторов для каждого куба
+    uint32_t free_slot = UINT32_MAX; ///< Начало списка свободных ячеек
+
+public:
+
+    static const int vertices = N;
+
+    PolygonPool() = default;
+
+    /// @brief Выделить память под capacity кубов, чтобы появление кубов не приводило к выделениям
+    void reserve(size_t capacity) {
+        for (auto *field: {&cx, &cy, &ux, &uy, &w, &radius, &rc, &rs})
+            field->reserve(capacity);
+        types.reserve(capacity);
+        for (int k = 0; k < N; k++) {
+            px[k].reserve(capacity);
+            py[k].reserve(capacity);
+        }
+        slots.reserve(capacity);
+        owners.reserve(capacity);
+    }
+
+    size_t size() const {
+        return cx.size();
+    }
+
+    bool empty() const {
+        return cx.empty();
+    }
+
+    /// @brief Добавить правильный многоугольник, первая вершина - левая верхняя
+    /// @param side Сторона квадрата с той же описанной окружностью; квадрат встает сторонами вдоль осей
+    CubeHandle spawn(const Vertex<double> &center, double side, const Vertex<double> &u, double omega, CubeType type) {
+        cx.push_back(center.x);
+        cy.push_back(center.y);
+        ux.push_back(u.x);
+        uy.push_back(u.y);
+        w.push_back(omega);
+        radius.push_back(side * M_SQRT1_2);
+        rc.push_back(1);
+        rs.push_back(0);
+        types.push_back(type);
+
+        unroll<N>([&](int k) {
+            px[k].push_back(0);
+            py[k].push_back(0);
+        });
+        place(size() - 1, regular_polygon<N>());
+
+        uint32_t slot;
+        if (free_slot != UINT32_MAX) {
+            slot = free_slot;
+            free_slot = slots[slot].index;
+        } else {
+            slot = uint32_t(slots.size());
+            slots.push_back({0, 0});
+        }
+        slots[slot].index = uint32_t(size() - 1);
+        owners.push_back(slot);
+        return {slot, slots[slot].generation};
+    }
+
+    /// @brief Удалить куб с индексом i, на его место встает последний куб
+    void remove_at(size_t i) {
+        const size_t last = size() - 1;
+        uint32_t slot = owners[i];
+        if (i != last) {
+            cx[i] = cx[last];
+            cy[i] = cy[last];
+            ux[i] = ux[last];
+            uy[i] = uy[last];
+            w[i] = w[last];
+            radius[i] = radius[last];
+            rc[i] = rc[last];
+            rs[i] = rs[last];
+            types[i] = types[last];
+            unroll<N>([&](int k) {
+                px[k][i] = px[k][last];
+                py[k][i] = py[k][last];
+            });
+            owners[i] = owners[last];
+            slots[owners[i]].index = uint32_t(i);
+        }
+        cx.pop_back();
+        cy.pop_back();
+        ux.pop_back();
+        uy.pop_back();
+        w.pop_back();
+        radius.pop_back();
+        rc.pop_back();
+        rs.pop_back();
+        types.pop_back();
+        unroll<N>([&](int k) {
+            px[k].pop_back();
+            py[k].pop_back();
+        });
+        owners.pop_back();
+
+        slots[slot].generation++;
+        slots[slot].index = free_slot;
+        free_slot = slot;
+    }
+
+    /// @brief Жив ли куб с данным идентификатором
+    bool contains(CubeHandle handle) const {
+        return handle.slot < slots.size() && slots[handle.slot].generation == handle.generation;
+    }
+
+    /// @brief Текущий индекс живого куба
+    size_t index_of(CubeHandle handle) const {
+        if (!contains(handle))
+            throw runtime_error("Cube handle is expired");
+        return slots[handle.slot].index;
+    }
+
+    /// @brief Удалить живой куб по идентификатору
+    void remove(CubeHandle handle) {
+        remove_at(index_of(handle));
+    }
+
+    /// @brief Идентификатор куба с индексом i
+    CubeHandle handle(size_t i) const {
+        return {owners[i], slots[owners[i]].generation};
+    }
+
+    /// @brief Удалить все кубы
+    void clear() {
+        while (!empty())
+            remove_at(size() - 1);
+    }
+
+    /// @brief Движение и вращение всех кубов
+    /// @details Поворот за шаг - малый угол, его синус и косинус считаются многочленом без вызовов libm,
+    /// поэтому движение на произвольное время, в том числе интерполяция кадра назад (dt < 0), не дороже
+    /// шага симуляции. Поворот куба накапливается умножением комплексных чисел с поправкой длины,
+    /// а вершины строятся заново по центру и повороту, поэтому форма не искажается.
+    void move(double dt) {
+        const PolygonPoints<N> &unit = regular_polygon<N>();
+        const size_t n = size();
+        for (size_t i = 0; i < n; i++) {
+            cx[i] += ux[i] * dt;
+            cy[i] += uy[i] * dt;
+
+            double step_c, step_s;
+            small_angle_rotor(w[i] * dt, step_c, step_s);
+            const double c = rc[i] * step_c - rs[i] * step_s;
+            const double s = rc[i] * step_s + rs[i] * step_c;
+            // шаг Ньютона для 1 / |(c, s)|: длина поворота остается равной 1 с точностью до округления
+            const double norm = 1.5 - 0.5 * (c * c + s * s);
+            rc[i] = c * norm;
+            rs[i] = s * norm;
+            place(i, unit);
+        }
+    }
+
+private:
+
+    /// @brief Вычислить вершины куба с индексом i по центру, радиусу и повороту
+    /// @param unit Вершины правильного многоугольника единичного радиуса, regular_polygon<N>()
+    void place(size_t i, const PolygonPoints<N> &unit) {
+        const double c = rc[i] * radius[i], s = rs[i] * radius[i];
+        unroll<N>([&](int k) {
+            px[k][i] = cx[i] + (unit[k].x * c - unit[k].y * s);
+            py[k][i] = cy[i] + (unit[k].x * s + unit[k].y * c);
+        });
+    }
+
+public:
+
+    Vertex<double> center(size_t i) const {
+        return {cx[i], cy[i]};
+    }
+
+    Vertex<double> velocity(size_t i) const {
+        return {ux[i], uy[i]};
+    }
+
+    double angular_speed(size_t i) const {
+        return w[i];
+    }
+
+    /// @brief Радиус окружности с центром в center(i), описанной вокруг куба
+    double bounding_radius(size_t i) const {
+        return radius[i];
+    }
+
+    CubeType type(size_t i) const {
+        return types[i];
+    }
+
+    /// @brief Вершины многоугольника с индексом i
+    PolygonPoints<N> points(size_t i) const {
+        PolygonPoints<N> res;
+        unroll<N>([&](int k) { res[k] = Vertex<double>(px[k][i], py[k][i]); });
+        return res;
+    }
+
+    /// @brief Массив координат x k-х вершин всех кубов
+    const double *xs(int k) const {
+        return px[k].data();
+    }
+
+    /// @brief Массив координат y k-х вершин всех кубов
+    const double *ys(int k) const {
+        return py[k].data();
+    }
+
+    /// @brief Все ли вершины куба с индексом i лежат на изображении
+    bool is_in_image(size_t i) const {
+        bool inside = true;
+        unroll<N>([&](int k) {
+            inside = inside && is_point_in_image(round_to_int(px[k][i]), round_to_int(py[k][i]));
+        });
+        return inside;
+    }
+
+    /// @brief Прямоугольник, который занимает куб с индексом i на экране
+    Rect bounds(size_t i) const {
+        return polygon_bounds(points(i));
+    }
+
+    /// @brief Заливка куба с индексом i
+    void fill(size_t i, const Color &color) const {
+        fill_convex_polygon(points(i), color);
+    }
+
+    /// @brief Продолжить хэш h состоянием всех кубов
+    uint64_t hash(uint64_t h) const {
+        for (auto *field: {&cx, &cy, &ux, &uy, &w, &radius, &rc, &rs})
+            h = hash_bytes(h, *field);
+        h = hash_bytes(h, types);
+        for (int k = 0; k < N; k++) {
+            h = hash_bytes(h, px[k]);
+            h = hash_bytes(h, py[k]);
+        }
+        return h;
+    }
+
+    /// @brief Отрисовка куба из пула как элемента кадра
+    static void draw_item(const DrawItem &item) {
+        static_cast<const PolygonPool *>(item.object)->fill(item.index, item.color);
+    }
+};
+
+using CubePool = PolygonPool<4>;
+
+/// @brief Пулы всех форм кубов: треугольников, квадратов и шестиугольников
+/// @details Каждая форма живет в своем пуле, поэтому код для нее компилируется с известным числом вершин.
+struct ShapePools {
+    static const int count = 3;
+
+    PolygonPool<3> triangles;
+    CubePool squares;
+    PolygonPool<6> hexagons;
+
+    /// @brief Вызвать f(pool, s) для каждого пула, s - номер пула от 0 до count - 1
+    template<class F>
+    void for_each(F &&f) {
+        f(triangles, 0);
+        f(squares, 1);
+        f(hexagons, 2);
+    }
+
+    template<class F>
+    void for_each(F &&f) const {
+        f(triangles, 0);
+        f(squares, 1);
+        f(hexagons, 2);
+    }
+
+    /// @brief Общее число кубов
+    size_t size() const {
+        return triangles.size() + squares.size() + hexagons.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    void reserve(size_t capacity) {
+        for_each([&](auto &pool, int) { pool.reserve(capacity); });
+    }
+
+    /// @brief Добавить правильный многоугольник из vertices вершин: 3, 4 или 6
+    CubeHandle spawn(int vertices, const Vertex<double> &center, double side, const Vertex<double> &u,
+                     double omega, CubeType type) {
+        switch (vertices) {
+            case 3:
+                return triangles.spawn(center, side, u, omega, type);
+            case 4:
+                return squares.spawn(center, side, u, omega, type);
+            case 6:
+                return hexagons.spawn(center, side, u, omega, type);
+            default:
+                throw runtime_error("Cube must have 3, 4 or 6 vertices");
+        }
+    }
+
+    void clear() {
+        for_each([](auto &pool, int) { pool.clear(); });
+    }
+
+    /// @brief Продолжить хэш h состоянием кубов всех форм
+    uint64_t hash(uint64_t h) const {
+        for_each([&](auto &pool, int) { h = pool.hash(h); });
+        return h;
+    }
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "Engine.h"
+
+using namespace std;
+
+inline bool is_rect_empty(const Rect &r) {
+    return r.x0 >= r.x1 || r.y0 >= r.y1;
+}
+
+inline Rect intersect(const Rect &a, const Rect &b) {
+    return {max(a.x0, b.x0), max(a.y0, b.y0), min(a.x1, b.x1), min(a.y1, b.y1)};
+}
+
+inline Rect unite(const Rect &a, const Rect &b) {
+    return {min(a.x0, b.x0), min(a.y0, b.y0), max(a.x1, b.x1), max(a.y1, b.y1)};
+}
+
+inline bool is_intersects(const Rect &a, const Rect &b) {
+    return !is_rect_empty(intersect(a, b));
+}
+
+const Rect screen_rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+
+/// @brief Отслеживание изменившихся областей кадра
+/// @details Объекты сообщают свои прямоугольники в каждом кадре, в котором сцена изменилась.
+/// Грязные области кадра - объединение прямоугольников прошлого и текущего кадров,
+/// пересекающиеся прямоугольники сливаются в один.
+class DamageTracker {
+    vector<Rect> previous; ///< Прямоугольники объектов в последнем нарисованном кадре
+    vector<Rect> current; ///< Прямоугольники объектов в текущем кадре
+    vector<Rect> dirty; ///< Области, которые нужно перерисовать
+    bool full = true; ///< Перерисовать кадр целиком
+
+    void push(vector<Rect> &rects, const Rect &r) {
+        Rect clipped = intersect(r, screen_rect);
+        if (!is_rect_empty(clipped))
+            rects.push_back(clipped);
+    }
+
+    void merge() {
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (size_t i = 0; i < dirty.size() && !merged; i++) {
+                for (size_t j = i + 1; j < dirty.size(); j++) {
+                    if (is_intersects(dirty[i], dirty[j])) {
+                        dirty[i] = unite(dirty[i], dirty[j]);
+                        dirty.erase(dirty.begin() + j);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+public:
+
+    DamageTracker() = default;
+
+    /// @brief Добавить прямоугольник объекта в текущем кадре
+    void add(const Rect &r) {
+        push(current, r);
+    }
+
+    /// @brief Перерисовать следующий кадр целиком
+    void invalidate_all() {
+        full = true;
+    }
+
+    /// @brief Завершить кадр с изменившейся сценой
+    /// @return Области, которые нужно восстановить и перерисовать
+    const vector<Rect> &commit() {
+        dirty.clear();
+        if (full) {
+            dirty.push_back(screen_rect);
+            full = false;
+        } else {
+            dirty.insert(dirty.end(), previous.begin(), previous.end());
+            dirty.insert(dirty.end(), current.begin(), current.end());
+            merge();
+        }
+
+        previous.swap(current);
+        current.clear();
+        return dirty;
+    }
+
+    /// @brief Завершить кадр, в котором сцена не изменилась
+    /// @details Объекты остались на месте, поэтому прямоугольники прошлого кадра сохраняются.
+    const vector<Rect> &skip() {
+        dirty.clear();
+        if (full) {
+            dirty.push_back(screen_rect);
+            full = false;
+        }
+
+        current.clear();
+        return dirty;
+    }
+
+    const vector<Rect> &get_dirty() const {
+        return dirty;
+    }
+};
@@ -2,37 +2,56 @@
 
 #include <vector>
 #include <ostream>
-#include <stack>
+#include <algorithm>
+#include "Engine.h"
+#include "damage.h"
+#include "kernels.h"
 #include "vertex.h"
 #include "color.h"
 #include "mathematics.h"
 #include "color_settings.h"
+#include "profiler.h"
 
 using namespace std;
 
-bool is_point_in_image(int x, int y) {
+inline bool is_point_in_image(int x, int y) {
     return 0 <= x && x < SCREEN_WIDTH && 0 <= y && y < SCREEN_HEIGHT;
 }
 
-bool is_point_in_image(const Vertex<int> &v) {
+inline bool is_point_in_image(const Vertex<int> &v) {
     return 0 <= v.x && v.x < SCREEN_WIDTH && 0 <= v.y && v.y < SCREEN_HEIGHT;
 }
 
-void set_pixel(int x, int y, const Color &col, bool skip_miss = false) {
-    if (skip_miss && !is_point_in_image(x, y)) {
-        return;
-    }
+/// @brief Область buffer, в которую разрешено рисовать текущему потоку
+/// @details При потайловой отрисовке каждый поток рисует только внутри своего тайла,
+/// все примитивы отсекаются по этой области.
+inline thread_local Rect clip_rect = screen_rect;
+
+inline bool is_point_in_clip(int x, int y) {
+    return clip_rect.x0 <= x && x < clip_rect.x1 && clip_rect.y0 <= y && y < clip_rect.y1;
+}
 
+/// @brief Упаковка цвета в формат пикселя buffer
+inline uint32_t to_pixel(const Color &col) {
     uint32_t p = col.r;
     p <<= 8;
     p |= col.g;
     p <<= 8;
     p |= col.b;
 
-    buffer[y][x] = p;
+    return p;
+}
+
+/// @param skip_miss - пропускать пиксели вне изображения; пиксели вне clip_rect пропускаются всегда
+inline void set_pixel(int x, int y, const Color &col, bool skip_miss = false) {
+    if ((skip_miss && !is_point_in_image(x, y)) || !is_point_in_clip(x, y)) {
+        return;
+    }
+
+    buffer[y][x] = to_pixel(col);
 }
 
-Color get_pixel(int x, int y) {
+inline Color get_pixel(int x, int y) {
     uint32_t p = buffer[y][x];
     Color color{};
     color.b = p & 0xFF;
@@ -42,148 +61,324 @@ Color get_pixel(int x, int y) {
     return color;
 }
 
-void set_pixel(const Vertex<int> &v, const Color &color, bool skip_miss = false) {
+inline void set_pixel(const Vertex<int> &v, const Color &color, bool skip_miss = false) {
     set_pixel(v.x, v.y, color, skip_miss);
 }
 
-Color get_pixel(const Vertex<int> &v) {
+inline Color get_pixel(const Vertex<int> &v) {
     return get_pixel(v.x, v.y);
 }
 
-void set_pixel(double x, double y, const Color &col, bool skip_miss = false) {
+inline void set_pixel(double x, double y, const Color &col, bool skip_miss = false) {
     set_pixel(int(round(x)), int(round(y)), col, skip_miss);
 }
 
-void set_pixel(const Vertex<double> &v, const Color &color, bool skip_miss = false) {
+inline void set_pixel(const Vertex<double> &v, const Color &color, bool skip_miss = false) {
     set_pixel(v.x, v.y, color, skip_miss);
 }
 
-/// @brief Отрисовка отрезка алгоритмом Брезенхема
-void draw_line(int x1, int y1, int x2, int y2, const Color &col, bool skip_miss = false) {
+/// @brief Обход пикселей отрезка алгоритмом Брезенхема
+/// @param plot - вызывается для каждого пикселя отрезка: plot(x, y)
+template<class F>
+inline void walk_line(int x1, int y1, int x2, int y2, F &&plot) {
     if (x1 > x2) {
         swap(x1, x2);
         swap(y1, y2);
     }
 
-    const int delta_x = 2 * abs(x2 - x1), delta_y = 2 * abs(y2 - y1);
-    const int step_x = x1 < x2 ? 1 : -1, step_y = y1 < y2 ? 1 : -1;
-    int error = delta_x - delta_y;
-    while (x1 != x2 && y1 != y2) {
-        set_pixel(x1, y1, col, skip_miss);
-        if (error > -delta_y) {
-            error -= delta_y;
-            x1 += step_x;
+    const int delta_x = x2 - x1, delta_y = -abs(y2 - y1);
+    const int step_y = y1 < y2 ? 1 : -1;
+    int error = delta_x + delta_y;
+    for (;;) {
+        plot(x1, y1);
+        if (x1 == x2 && y1 == y2)
+            break;
+        const int error2 = 2 * error;
+        if (error2 >= delta_y) {
+            error += delta_y;
+            x1++;
         }
-        if (error < delta_x) {
+        if (error2 <= delta_x) {
             error += delta_x;
             y1 += step_y;
         }
     }
-    while (x1 != x2) {
-        set_pixel(x1, y2, col, skip_miss);
-        x1 += step_x;
-    }
-    while (y1 != y2) {
-        set_pixel(x2, y1, col, skip_miss);
-        y1 += step_y;
-    }
-    set_pixel(x2, y2, col, skip_miss);
 }
 
-void draw_line(const Vertex<int> &from, const Vertex<int> &to, const Color &color, bool skip_miss = false) {
+/// @brief Отрисовка отрезка алгоритмом Брезенхема
+inline void draw_line(int x1, int y1, int x2, int y2, const Color &col, bool skip_miss = false) {
+    walk_line(x1, y1, x2, y2, [&](int x, int y) {
+        set_pixel(x, y, col, skip_miss);
+    });
+}
+
+inline void draw_line(const Vertex<int> &from, const Vertex<int> &to, const Color &color, bool skip_miss = false) {
     draw_line(from.x, from.y, to.x, to.y, color, skip_miss);
 }
 
-void draw_line(const Vertex<double> &from, const Vertex<double> &to, const Color &color, bool skip_miss = false) {
+inline void draw_line(const Vertex<double> &from, const Vertex<double> &to, const Color &color, bool skip_miss = false) {
     draw_line(round_to_int(from.x), round_to_int(from.y),
               round_to_int(to.x), round_to_int(to.y),
               color, skip_miss);
 }
 
-/// @brief Отрисовка кривой Безье
-void draw_bezier_curve(const vector<Vertex<double>> &init_points, const Color &color, bool skip_miss = false) {
-    size_t n = init_points.size();
-    auto coeffs = get_comb_coeffs(n);
-
-    // sum(coeffs[i] * (1 - t) ^ (n - i) * t ^ i * points[i])
-    Vertex<int> last = to_int_point(init_points[0]);
-    for (double t = 0.0; t <= 1.0; t += 0.01) {
-        Vertex<double> p = {0.0, 0.0};
-        for (size_t i = 0; i < n; i++) {
-            p += init_points[i] * (coeffs[i] * pow((1 - t), n - i - 1) * pow(t, i));
+/// @brief Допустимое отклонение ломаной от кривой Безье, пикселей
+const double bezier_tolerance = 0.25;
+
+/// @brief Наибольшее число отрезков на кусок кривой: более изогнутые кривые сначала делятся пополам
+const int bezier_max_segments = 16;
+
+/// @brief Разбиение кривой Безье на отрезки
+/// @details Число отрезков берется из оценки Ванга: при равномерном шаге 1/m отклонение ломаной от кривой
+/// степени d не больше d(d - 1) / 8 * max|P[i] - 2P[i+1] + P[i+2]| / m^2. Короткая или пологая кривая дает
+/// один-два отрезка. Если отрезков нужно больше bezier_max_segments, кривая делится пополам алгоритмом де Кастельжо,
+/// и каждая половина разбивается отдельно. Точки внутри куска считаются конечными разностями многочлена
+/// в степенном базисе, без pow() и без вычисления многочленов Бернштейна в каждой точке.
+/// @param points Контрольные точки, n от 1 до max_bernstein_degree + 1
+/// @param emit Вызывается для концов всех отрезков по порядку, начальная точка кривой не передается
+template<class Emit>
+inline void flatten_bezier(const Vertex<double> *points, int n, Emit &&emit, int depth = 0) {
+    const int d = n - 1;
+    double bend = 0;
+    for (int i = 0; i + 2 <= d; i++)
+        bend = max(bend, (points[i] - points[i + 1] * 2 + points[i + 2]).mod());
+    const int segments = max(1, int(ceil(sqrt(d * (d - 1) * bend / (8 * bezier_tolerance)))));
+
+    if (segments > bezier_max_segments && depth < 16) {
+        Vertex<double> left[max_bernstein_degree + 1], right[max_bernstein_degree + 1], work[max_bernstein_degree + 1];
+        for (int i = 0; i < n; i++)
+            work[i] = points[i];
+        for (int level = 0; level < n; level++) {
+            left[level] = work[0];
+            right[d - level] = work[d - level];
+            for (int i = 0; i + level < d; i++)
+                work[i] = (work[i] + work[i + 1]) * 0.5;
         }
+        flatten_bezier(left, n, emit, depth + 1);
+        flatten_bezier(right, n, emit, depth + 1);
+        return;
+    }
+
+    // степенной базис: B(t) = sum(a[j] * t^j), a[j] = C(d, j) * sum((-1)^(j - i) * C(j, i) * P[i])
+    Vertex<double> a[max_bernstein_degree + 1];
+    for (int j = 0; j <= d; j++) {
+        Vertex<double> sum;
+        for (int i = 0; i <= j; i++)
+            sum += points[i] * double((j - i) % 2 ? -binomial(j, i) : binomial(j, i));
+        a[j] = sum * double(binomial(d, j));
+    }
 
+    // начальные конечные разности: diff[k] = Δ^k B(0) с шагом h
+    const double h = 1.0 / segments;
+    Vertex<double> diff[max_bernstein_degree + 1];
+    for (int k = 0; k <= d; k++) {
+        const double t = k * h;
+        Vertex<double> value = a[d];
+        for (int j = d - 1; j >= 0; j--)
+            value = value * t + a[j];
+        diff[k] = value;
+    }
+    for (int level = 1; level <= d; level++)
+        for (int k = d; k >= level; k--)
+            diff[k] -= diff[k - 1];
+
+    for (int step = 1; step < segments; step++) {
+        for (int k = 0; k < d; k++)
+            diff[k] += diff[k + 1];
+        emit(diff[0]);
+    }
+    emit(points[d]);
+}
+
+/// @brief Обход пикселей кривой Безье
+/// @param points Контрольные точки, n от 1 до max_bernstein_degree + 1
+/// @param plot - вызывается для каждого пикселя кривой: plot(x, y)
+template<class F>
+inline void walk_bezier_curve(const Vertex<double> *points, int n, F &&plot) {
+    if (n < 1 || n > max_bernstein_degree + 1)
+        throw runtime_error("Bezier curve must have from 1 to 16 points");
+
+    Vertex<int> last = to_int_point(points[0]);
+    bool drawn = false;
+    flatten_bezier(points, n, [&](const Vertex<double> &p) {
         Vertex<int> cur = to_int_point(p);
-        if ((cur - last).mod2() > 3) {
-            draw_line(last, cur, color, skip_miss);
+        if (cur != last) {
+            walk_line(last.x, last.y, cur.x, cur.y, plot);
             last = cur;
+            drawn = true;
         }
+    });
+    if (!drawn) // кривая меньше пикселя
+        plot(last.x, last.y);
+}
+
+/// @brief Отрисовка кривой Безье
+/// @param points Контрольные точки, n от 1 до max_bernstein_degree + 1
+inline void draw_bezier_curve(const Vertex<double> *points, int n, const Color &color, bool skip_miss = false) {
+    walk_bezier_curve(points, n, [&](int x, int y) {
+        set_pixel(x, y, color, skip_miss);
+    });
+}
+
+/// @brief Горизонтальный отрезок пикселей [x0, x1) строки y
+struct PixelRun {
+    int y, x0, x1;
+};
+
+/// @brief Собрать пиксели в горизонтальные отрезки, порядок пикселей и повторы не важны
+inline void pixels_to_runs(vector<Vertex<int>> &pixels, vector<PixelRun> &runs) {
+    sort(pixels.begin(), pixels.end(), [](const Vertex<int> &a, const Vertex<int> &b) {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+    runs.clear();
+    for (auto &p: pixels) {
+        if (!runs.empty() && runs.back().y == p.y && runs.back().x1 >= p.x)
+            runs.back().x1 = max(runs.back().x1, p.x + 1);
+        else
+            runs.push_back({p.y, p.x, p.x + 1});
     }
+}
+
+/// @brief Заливка горизонтальных отрезков с отсечением по clip_rect
+inline void fill_runs(const vector<PixelRun> &runs, const Color &color) {
+    const Rect clip = clip_rect;
+    const uint32_t p = to_pixel(color);
+    for (auto &run: runs) {
+        if (run.y < clip.y0 || run.y >= clip.y1)
+            continue;
+        int from = max(run.x0, clip.x0), to = min(run.x1, clip.x1);
+        if (from < to)
+            fill_span(buffer[run.y] + from, size_t(to - from), p);
+    }
+}
 
-    draw_line(last, to_int_point(init_points.back()), color, skip_miss);
+inline void draw_bezier_curve(const vector<Vertex<double>> &init_points, const Color &color, bool skip_miss = false) {
+    draw_bezier_curve(init_points.data(), int(init_points.size()), color, skip_miss);
 }
 
-void draw_bezier_curve(const vector<Vertex<int>> &init_points, const Color &color, bool skip_miss = false) {
-    vector<Vertex<double>> points(init_points.size());
+inline void draw_bezier_curve(const vector<Vertex<int>> &init_points, const Color &color, bool skip_miss = false) {
+    if (init_points.empty() || init_points.size() > max_bernstein_degree + 1)
+        throw runtime_error("Bezier curve must have from 1 to 16 points");
+
+    Vertex<double> points[max_bernstein_degree + 1];
     for (size_t i = 0; i < init_points.size(); ++i) {
         points[i] = to_double_point(init_points[i]);
     }
 
-    draw_bezier_curve(points, color, skip_miss);
-}
-
-/// @brief Заливка фигуры
-/// @param seed - начальная точка
-/// @param new_color - цвет закраски
-/// @param stop_color - цвет, за который нельзя выходить
-void fill_figure(const Vertex<int> &seed, const Color &new_color, const Color &stop_color = bounds_color) {
-    static const int dx[4] = {0, 1, 0, -1}; // смещения для получения координат 4-х соседей
-    static const int dy[4] = {-1, 0, 1, 0};
-    std::stack<Vertex<int>> stack;
-
-    if(is_point_in_image(seed)){
-        stack.push(seed);
-    } else {
-        for(int i = 0; i < 4; i++){
-            Vertex<int> next(seed.x + dx[i], seed.y + dy[i]);
-            if (is_point_in_image(next)) {
-                Color currentColor = get_pixel(next);
-                if (!(currentColor == stop_color) && !(currentColor == new_color)) {
-                    stack.push(next);
-                    break;
-                }
-            }
-        }
+    draw_bezier_curve(points, int(init_points.size()), color, skip_miss);
+}
+
+/// @brief Заливка круга построчными отрезками
+/// @details Полуширина каждой строки берется из целочисленного алгоритма средней точки (как в Circle::draw),
+/// после чего каждая строка круга записывается ровно один раз с отсечением по clip_rect.
+inline void fill_disk(int cx, int cy, int r, const Color &color) {
+    PROFILE_SCOPE("fill_disk");
+    if (r < 0)
+        return;
+
+    static thread_local vector<int> half; // полуширина строки на расстоянии dy от центра
+    half.assign(r + 1, 0);
+
+    int x = 0, y = r;
+    int d = 3 - 2 * r;
+    while (y >= x) {
+        half[y] = max(half[y], x);
+        half[x] = max(half[x], y);
+        x++;
+        if (d > 0) {
+            y--;
+            d = d + 4 * (x - y) + 10;
+        } else
+            d = d + 4 * x + 6;
     }
 
-    while (!stack.empty()) {
-        Vertex<int> v = stack.top();
-        stack.pop();
-        set_pixel(v, new_color, true);
-        for (int i = 0; i < 4; i++) {
-            Vertex<int> next(v.x + dx[i], v.y + dy[i]);
-            if (is_point_in_image(next)) {
-                Color currentColor = get_pixel(next);
-                if (!(currentColor == stop_color) && !(currentColor == new_color)) {
-                    stack.push(next);
-                }
-            }
-        }
+    const uint32_t p = to_pixel(color);
+    const Rect clip = clip_rect;
+    auto fill_row = [&](int row, int w) {
+        if (row < clip.y0 || row >= clip.y1)
+            return;
+        int from = max(cx - w, clip.x0), to = min(cx + w, clip.x1 - 1);
+        if (from <= to)
+            fill_span(buffer[row] + from, size_t(to - from + 1), p);
+    };
+
+    fill_row(cy, half[0]);
+    for (int dy = 1; dy <= r; dy++) {
+        fill_row(cy - dy, half[dy]);
+        fill_row(cy + dy, half[dy]);
     }
 }
 
-void draw_bounds() {
-    for (int y = 0; y < bounds_size; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            set_pixel(x, y, bounds_color);
-            set_pixel(x, SCREEN_HEIGHT - y - 1, bounds_color);
-        }
+/// @brief Заливка выпуклого многоугольника построчными отрезками
+/// @details Границы каждой строки берутся из пикселей ребер, построенных тем же алгоритмом Брезенхема,
+/// что и draw_line, поэтому результат совпадает с обводкой и заливкой изнутри.
+/// В отличие от заливки от затравки, не читает buffer и корректно отсекается по clip_rect.
+template<class Points>
+inline void fill_convex_polygon(const Points &points, const Color &color) {
+    PROFILE_SCOPE("fill_polygon");
+    const int n = int(points.size());
+    int y_min = round_to_int(points[0].y), y_max = y_min;
+    for (auto &p: points) {
+        y_min = min(y_min, round_to_int(p.y));
+        y_max = max(y_max, round_to_int(p.y));
     }
 
-    for (int x = 0; x < bounds_size; x++) {
-        for (int y = bounds_size; y < SCREEN_HEIGHT - bounds_size; y++) {
-            set_pixel(x, y, bounds_color);
-            set_pixel(SCREEN_WIDTH - x - 1, y, bounds_color);
-        }
+    const Rect clip = clip_rect;
+    if (y_max < clip.y0 || y_min >= clip.y1)
+        return;
+
+    static thread_local vector<int> lo, hi; // границы строк y_min + i
+    lo.assign(y_max - y_min + 1, INT32_MAX);
+    hi.assign(y_max - y_min + 1, INT32_MIN);
+    for (int i = 0; i < n; i++) {
+        auto &from = points[i];
+        auto &to = points[circle_idx(i + 1, n)];
+        walk_line(round_to_int(from.x), round_to_int(from.y), round_to_int(to.x), round_to_int(to.y),
+                  [&](int x, int y) {
+                      lo[y - y_min] = min(lo[y - y_min], x);
+                      hi[y - y_min] = max(hi[y - y_min], x);
+                  });
+    }
+
+    const uint32_t p = to_pixel(color);
+    for (int y = max(y_min, clip.y0); y <= min(y_max, clip.y1 - 1); y++) {
+        int from = max(lo[y - y_min], clip.x0), to = min(hi[y - y_min], clip.x1 - 1);
+        if (from <= to)
+            fill_span(buffer[y] + from, size_t(to - from + 1), p);
     }
 }
+
+/// @brief Прямоугольник, который занимает многоугольник на экране
+template<class Points>
+inline Rect polygon_bounds(const Points &points) {
+    Vertex<int> p = to_int_point(points[0]);
+    Rect box = {p.x, p.y, p.x + 1, p.y + 1};
+    for (auto &point: points) {
+        p = to_int_point(point);
+        box = unite(box, {p.x, p.y, p.x + 1, p.y + 1});
+    }
+    return box;
+}
+
+/// @brief Элемент кадра для потайловой отрисовки
+/// @details Рисуется функцией draw, которая не должна выходить за clip_rect.
+struct DrawItem {
+    Rect bounds; ///< Прямоугольник, вне которого элемент ничего не рисует
+    void (*draw)(const DrawItem &item);
+    const void *object; ///< Рисуемый объект
+    Color color;
+    size_t index = 0; ///< Номер элемента внутри object, если объект - набор элементов
+};
+
+/// @brief Полосы рамки вокруг игрового поля: верхняя, нижняя, левая и правая
+const Rect bounds_strips[4] = {
+        {0,                          0,                           SCREEN_WIDTH, bounds_size},
+        {0,                          SCREEN_HEIGHT - bounds_size, SCREEN_WIDTH, SCREEN_HEIGHT},
+        {0,                          bounds_size,                 bounds_size,  SCREEN_HEIGHT - bounds_size},
+        {SCREEN_WIDTH - bounds_size, bounds_size,                 SCREEN_WIDTH, SCREEN_HEIGHT - bounds_size},
+};
+
+inline void draw_bounds() {
+    for (auto &strip: bounds_strips)
+        fill_rect(intersect(strip, clip_rect), to_pixel(bounds_color));
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <time.h>
+
+using namespace std;
+
+/// @brief Время CLOCK_MONOTONIC в наносекундах
+inline uint64_t monotonic_nsec() {
+    timespec ts = {0, 0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + uint64_t(ts.tv_nsec);
+}
+
+/// @brief Часы симуляции с фиксированным шагом
+/// @details Реальное время копится, и act() вызывается целым числом шагов одной длины, поэтому ход игры
+/// не зависит от частоты кадров. Остаток меньше шага отдается отрисовке как доля шага для интерполяции.
+class FixedStepClock {
+    uint64_t tick_ns;
+    int max_steps; ///< Больше шагов за кадр не делается: после долгой паузы игра не догоняет время
+    uint64_t prev = 0;
+    uint64_t accumulator = 0;
+
+public:
+
+    /// @param tick Длина шага, с
+    /// @param max_lag Наибольшее время, которое симуляция догоняет за один кадр, с
+    explicit FixedStepClock(double tick, double max_lag = 0.1) : tick_ns(uint64_t(tick * 1e9)),
+                                                                 max_steps(max(1, int(max_lag / tick))) {
+        if (tick_ns == 0)
+            throw runtime_error("Simulation tick must be greater then zero");
+    }
+
+    /// @brief Начать отсчет с момента now
+    void reset(uint64_t now) {
+        prev = now;
+        accumulator = 0;
+    }
+
+    /// @brief Учесть время до момента now
+    /// @return Сколько шагов симуляции нужно сделать
+    int advance(uint64_t now) {
+        accumulator += now - prev;
+        prev = now;
+        uint64_t steps = accumulator / tick_ns;
+        accumulator -= steps * tick_ns;
+        if (steps > uint64_t(max_steps)) {
+            steps = max_steps;
+            accumulator = 0;
+        }
+        return int(steps);
+    }
+
+    /// @brief Длина шага, с
+    double tick() const {
+        return double(tick_ns) * 1e-9;
+    }
+
+    /// @brief Доля шага, прошедшая после последнего шага симуляции, [0, 1)
+    float alpha() const {
+        return float(double(accumulator) / double(tick_ns));
+    }
+};
+
+/// @brief Ограничение частоты кадров
+/// @details Поток спит в clock_nanosleep до момента чуть раньше начала кадра, а последние spin наносекунд
+/// ждет в цикле: пробуждение после сна запаздывает на время порядка шага планировщика.
+class FramePacer {
+    uint64_t interval; ///< 0 - без ограничения
+    uint64_t spin;
+    uint64_t deadline = 0; ///< Начало следующего кадра
+
+public:
+
+    /// @param fps Наибольшая частота кадров, 0 - без ограничения
+    /// @param spin Сколько наносекунд перед началом кадра ждать в цикле, а не во сне
+    explicit FramePacer(double fps, uint64_t spin = 500000) : interval(fps > 0 ? uint64_t(1e9 / fps) : 0),
+                                                              spin(spin) {}
+
+    /// @brief Дождаться начала следующего кадра
+    void wait() {
+        if (interval == 0)
+            return;
+
+        uint64_t now = monotonic_nsec();
+        // кадр опоздал больше чем на интервал - отсчет начинается заново, без серии кадров вдогонку
+        if (deadline == 0 || now > deadline + interval)
+            deadline = now;
+
+        if (deadline > now + spin) {
+            uint64_t wake = deadline - spin;
+            timespec ts = {time_t(wake / 1000000000), long(wake % 1000000000)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+        }
+        while (monotonic_nsec() < deadline) {}
+
+        deadline += interval;
+    }
+};
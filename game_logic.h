@@ -1,7 +1,12 @@
 #pragma once
 
+#include "arena.h"
+#include "collision.h"
 #include "cube_launcher.h"
 #include "rotator.h"
+#include "snapshot.h"
+#include "swept_collision.h"
+#include "uniform_grid.h"
 
 /// @brief Класс, предназначенный для обработки логики взаимодействия кругов и кубов
 class GameLogic {
@@ -13,6 +18,7 @@ class GameLogic {
 
     double time = 0;
     bool is_freeze = false;
+    unsigned long version = 0; ///< Счетчик изменений состояния, влияющих на отрисовку
 
     bool dynamic_difficult; ///< Усложнять ли игру динамически
     int last_up_score = 5; ///< Результат, по достижении которого игра усложнится
@@ -20,6 +26,10 @@ class GameLogic {
     double up_w = 1.1; ///< Коэффициент прироста скорости вращения кругов
     double down_T = 0.8; ///< Коэффициент уменьшения периода появления кубов
 
+    UniformGrid circle_grid; ///< Круги по центрам, перестраивается при каждой проверке пересечений
+    FrameArena arena; ///< Временные буферы проверки пересечений, освобождается в начале update_score
+    vector<CubeHandle> swept_hits[ShapePools::count]; ///< Кубы, коснувшиеся круга в течение последнего шага
+
 public:
 
     GameLogic() = default;
@@ -33,81 +43,152 @@ public:
 
 private:
 
-    /// @brief Проверка пересекаются ли куб и круг
-    bool is_intersects(const Cube &cube, const Circle &circle) const {
-        bool check_close = false;
-        for (auto &p: cube.points) {
-            if ((circle.center - p).mod() < 1.5 * circle.r) {
-                check_close = true;
-                break;
-            }
-        }
-        if (!check_close) {
-            return false;
-        }
-
-        int n = cube.points.size();
-        for (int i = 0; i < n; i++) {
-            const Vertex<double> &p1 = cube.points[i];
-            const Vertex<double> &p2 = cube.points[circle_idx(i + 1, n)];
-
-            double c1 = p1.x;
-            double c = p2.x - p1.x;
-            double c3 = p1.y;
-            double d = p2.y - p1.y;
+    /// @brief Разложить круги по сетке для проверки пересечений с кубами всех форм
+    /// @details Ячейка не меньше наибольшего куба или круга.
+    /// @return Наибольший радиус круга
+    double build_circle_grid() {
+        auto &circles = rotator.get_circles();
+        double r_max = 0, extent = 1;
+        for (auto &circle: circles)
+            r_max = max(r_max, circle.r);
+        cube_launcher.shapes.for_each([&](auto &cubes, int) {
+            for (size_t i = 0; i < cubes.size(); i++)
+                extent = max(extent, 2 * cubes.bounding_radius(i));
+        });
+
+        circle_grid.build(max(2 * r_max, extent), circles.size(), [&](size_t j) { return circles[j].center; });
+        return r_max;
+    }
 
-            // (ct - a)^2 + (dt - b)^2 = r^2
-            double a = circle.center.x - c1;
-            double b = circle.center.y - c3;
+    /// @brief Проверка пересечений кубов одной формы с кругами
+    /// @details Куб сравнивается только с кругами из ячеек сетки вокруг своего прямоугольника. Пары, у которых
+    /// пересекаются описанная окружность куба и круг, проверяются точно одним пакетом. Пересечением считается
+    /// любая общая точка, в том числе круг целиком внутри куба и куб целиком внутри круга.
+    /// @param r_max Наибольший радиус круга, см. build_circle_grid()
+    /// @return hits[i] = 1, если i-й куб пересекается с каким-нибудь кругом; память - в arena
+    template<int N>
+    FrameVector<uint8_t> find_intersections(const PolygonPool<N> &cubes, double r_max) {
+        auto &circles = rotator.get_circles();
+        FrameVector<uint8_t> hits(cubes.size(), 0, ArenaAllocator<uint8_t>(arena));
+        if (circles.empty() || cubes.empty())
+            return hits;
+
+        BasicCirclePolygonPairs<ArenaAllocator<double>> pairs{ArenaAllocator<double>(arena)};
+        FrameVector<uint32_t> pair_cubes{ArenaAllocator<uint32_t>(arena)};
+        pairs.clear(N);
+        for (size_t i = 0; i < cubes.size(); i++) {
+            const Rect box = cubes.bounds(i);
+            const Vertex<double> center = cubes.center(i);
+            const double radius = cubes.bounding_radius(i);
+            const PolygonPoints<N> points = cubes.points(i);
+            circle_grid.query(box.x0 - r_max - 1, box.y0 - r_max - 1, box.x1 + r_max, box.y1 + r_max, [&](size_t j) {
+                const Circle &circle = circles[j];
+                const double reach = radius + circle.r;
+                if ((circle.center - center).mod2() > reach * reach)
+                    return;
+                pairs.add(circle.center.x, circle.center.y, circle.r, points);
+                pair_cubes.push_back(uint32_t(i));
+            });
+        }
 
-            // At^2 - 2Bt + C = 0
-            double A = c * c + d * d;
-            double B = a * c + d * b;
-            double C = a * a + b * b - circle.r * circle.r;
+        FrameVector<uint8_t> pair_hits(pairs.size(), 0, ArenaAllocator<uint8_t>(arena));
+        collision_kernels().circle_polygon(pairs.view(), pair_hits.data());
+        for (size_t p = 0; p < pairs.size(); p++)
+            if (pair_hits[p])
+                hits[pair_cubes[p]] = 1;
+        return hits;
+    }
 
-            double D = B * B - A * C;
-            if (D < 0) {
-                continue;
-            }
+    /// @brief Найти кубы, которые коснутся кругов за время dt, пока кубы и круги движутся
+    /// @details Проверка после шага видит только конечное положение, и быстрый куб может пролететь
+    /// сквозь круг между кадрами. Здесь для каждой близкой пары ищется момент касания на всем шаге.
+    /// @param circles_w Угловая скорость кругов на этом шаге
+    void sweep(double dt, double circles_w) {
+        for (auto &hits: swept_hits)
+            hits.clear();
+        auto &circles = rotator.get_circles();
+        if (circles.empty() || cube_launcher.shapes.empty())
+            return;
 
-            double sqr = sqrt(D);
-            double t1 = (B + sqr) / A;
-            double t2 = (B - sqr) / A;
-            if ((0 <= t1 && t1 <= 1) || (0 <= t2 && t2 <= 1)) {
-                return true;
-            }
+        double r_max = 0, circle_path = 0;
+        for (auto &circle: circles) {
+            r_max = max(r_max, circle.r);
+            circle_path = max(circle_path, fabs(circles_w) * (circle.center - rotator.get_center()).mod() * dt);
         }
+        circle_grid.build(2 * r_max + circle_path, circles.size(), [&](size_t j) { return circles[j].center; });
 
-        return false;
+        cube_launcher.shapes.for_each([&](auto &cubes, int s) {
+            sweep(cubes, dt, circles_w, r_max, circle_path, swept_hits[s]);
+        });
     }
 
-    /// @brief Проверка пересечений всех существующих кубов и кругов
-    vector<bool> find_intersections() const {
+    /// @brief Непрерывная проверка для кубов одной формы, сетка кругов уже построена
+    template<int N>
+    void sweep(const PolygonPool<N> &cubes, double dt, double circles_w, double r_max, double circle_path,
+               vector<CubeHandle> &touched_cubes) const {
         auto &circles = rotator.get_circles();
-        vector<bool> res;
-        res.reserve(circles.size());
-        for (auto &cube: cube_launcher.cubes) {
-            bool intersects = false;
-            for (auto &circle: circles) {
-                if (is_intersects(cube, circle)) {
-                    intersects = true;
+        for (size_t i = 0; i < cubes.size(); i++) {
+            const SweptPolygon<N> cube = {cubes.points(i), cubes.center(i), cubes.velocity(i),
+                                          cubes.angular_speed(i), cubes.bounding_radius(i)};
+            const double cube_reach = cube.radius + cube.u.mod() * dt + circle_path;
+            bool touched = false;
+            circle_grid.query(cube.center.x - cube_reach - r_max, cube.center.y - cube_reach - r_max,
+                              cube.center.x + cube_reach + r_max, cube.center.y + cube_reach + r_max, [&](size_t j) {
+                        const Circle &circle = circles[j];
+                        const double reach = cube_reach + circle.r;
+                        if (touched || (circle.center - cube.center).mod2() > reach * reach)
+                            return;
+                        touched = time_of_impact(cube, {circle.center, circle.r, rotator.get_center(), circles_w}, dt) >= 0;
+                    });
+            if (touched)
+                touched_cubes.push_back(cubes.handle(i));
+        }
+    }
+
+    /// @brief Применить столкновения кубов одной формы с кругами и удалить столкнувшиеся кубы
+    /// @param touched_cubes Кубы, коснувшиеся кругов в течение шага
+    /// @return false - если столкнулся убивающий куб
+    template<int N>
+    bool resolve_hits(PolygonPool<N> &cubes, double r_max, const vector<CubeHandle> &touched_cubes) {
+        FrameVector<uint8_t> hits = find_intersections(cubes, r_max);
+        for (auto handle: touched_cubes)
+            if (cubes.contains(handle))
+                hits[cubes.index_of(handle)] = 1;
+
+        // с конца: удаление переносит на место куба последний, уже обработанный
+        for (size_t i = hits.size(); i-- > 0;) {
+            if (!hits[i])
+                continue;
+
+            switch (cubes.type(i)) {
+                case Projectile:
+                    return false;
+                case Bonus:
+                    score++;
+                    break;
+                case Freeze:
+                    time = freeze_time;
+                    is_freeze = true;
                     break;
-                }
             }
-            res.push_back(intersects);
-        }
 
-        return res;
+            cubes.remove_at(i);
+        }
+        return true;
     }
 
 public:
 
     /// @brief Движение кубов и вращение кругов
     void actions(double dt) {
+        PROFILE_SCOPE("actions");
+        version++;
         time -= dt;
         if (is_freeze && time <= 0)
             is_freeze = false;
 
+        sweep(dt, is_freeze ? 0 : rotator.get_angular_velocity());
+
         if (!is_freeze)
             rotator.rotate(dt);
 
@@ -115,43 +196,38 @@ public:
         cube_launcher.generate(dt);
     }
 
-    /// @brief Отрисовка кругов и кубов
-    void draw() {
+    /// @brief Отрисовка кругов
+    void draw_circles() const {
         if (is_freeze)
             rotator.draw(freeze_color);
         else
             rotator.draw(circle_color);
+    }
 
+    /// @brief Отрисовка кубов
+    void draw_cubes() {
         cube_launcher.draw();
     }
 
+    /// @brief Отрисовка кругов и кубов
+    void draw() {
+        draw_circles();
+        draw_cubes();
+    }
+
     /// @brief Обновляем счет и обрабатываем результат взаимодействия куба и круга
     /// @return true - если игра может продолжатся, false - если игра окончена
     bool update_score() {
-        auto res = find_intersections();
-        auto it = cube_launcher.cubes.begin();
-        for (int i = 0; i < res.size(); i++) {
-            if (!res[i]) {
-                it++;
-                continue;
-            }
-
-            switch (it->type) {
-                case Projectile:
-                    return false;
-                case Bonus:
-                    score++;
-                    break;
-                case Freeze:
-                    time = freeze_time;
-                    is_freeze = true;
-                    break;
-            }
-
-            auto cur = it;
-            it++;
-            cube_launcher.cubes.erase(cur);
-        }
+        PROFILE_SCOPE("update_score");
+        arena.reset();
+        const double r_max = build_circle_grid();
+        bool alive = true;
+        cube_launcher.shapes.for_each([&](auto &cubes, int s) {
+            alive = alive && resolve_hits(cubes, r_max, swept_hits[s]);
+            swept_hits[s].clear();
+        });
+        if (!alive)
+            return false;
 
         if (dynamic_difficult && score >= last_up_score) {
             last_up_score *= 2;
@@ -171,6 +247,49 @@ public:
         }
     }
 
+    /// @brief Сохранить в снимок все, что нужно для отрисовки
+    void make_snapshot(Snapshot &snapshot) const {
+        auto &circles = rotator.get_circles();
+        snapshot.circles.assign(circles.begin(), circles.end());
+        snapshot.shapes = cube_launcher.shapes;
+        snapshot.score = score;
+        snapshot.freeze = is_freeze;
+        snapshot.version = version;
+        snapshot.pivot = rotator.get_center();
+        snapshot.circles_w = is_freeze ? 0 : rotator.get_angular_velocity();
+    }
+
+    /// @brief Номер версии состояния: меняется, когда меняется то, что видно на экране
+    unsigned long get_version() const {
+        return version;
+    }
+
+    /// @brief Хэш всего состояния симуляции
+    /// @details Совпадает у двух запусков тогда и только тогда (с точностью до коллизий), когда их состояния
+    /// совпадают бит в бит; по нему воспроизведение проверяет, что идет так же, как запись.
+    uint64_t state_hash() const {
+        uint64_t h = fnv_offset_basis;
+        h = hash_bytes(h, score);
+        h = hash_bytes(h, time);
+        h = hash_bytes(h, is_freeze);
+        h = hash_bytes(h, last_up_score);
+        h = rotator.hash(h);
+        return cube_launcher.hash(h);
+    }
+
+    /// @brief Задать зерно генератора кубов
+    void seed(unsigned value) {
+        cube_launcher.seed(value);
+    }
+
+    const Rotator &get_rotator() const {
+        return rotator;
+    }
+
+    const CubeLauncher &get_cube_launcher() const {
+        return cube_launcher;
+    }
+
     /// @brief Получение текущего счета
     int get_score() const {
         return score;
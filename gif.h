@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "draw.h"
+
+using namespace std;
+
+/// @brief Палитра GIF из 256 цветов: цвета игры, куб 6x6x6 и оттенки серого
+/// @details Игра рисует только цветами из color_settings.h, поэтому индекс почти любого пикселя
+/// находится в кэше с первого обращения. Для прочих цветов ищется ближайший цвет палитры,
+/// и результат тоже запоминается в кэше.
+class GifPalette {
+    static const int cache_bits = 12;
+
+    uint32_t colors[256];
+    uint32_t cache_key[1 << cache_bits] = {}; ///< Пиксель + 1, 0 - пустая ячейка
+    uint8_t cache_index[1 << cache_bits] = {};
+
+    int nearest(uint32_t p) const {
+        int best = 0, best_d = INT32_MAX;
+        for (int i = 0; i < 256; i++) {
+            int dr = int(p >> 16) - int(colors[i] >> 16);
+            int dg = int((p >> 8) & 0xff) - int((colors[i] >> 8) & 0xff);
+            int db = int(p & 0xff) - int(colors[i] & 0xff);
+            int d = dr * dr + dg * dg + db * db;
+            if (d < best_d) {
+                best = i;
+                best_d = d;
+            }
+        }
+        return best;
+    }
+
+public:
+
+    GifPalette() {
+        int n = 0;
+        // фон первым: он же цвет фона логического экрана GIF
+        for (const Color &c: {background_color, bounds_color, circle_color, projectile_color, bonus_color,
+                              freeze_color, score_color, score_background_color})
+            colors[n++] = to_pixel(c);
+        for (int r = 0; r < 6; r++)
+            for (int g = 0; g < 6; g++)
+                for (int b = 0; b < 6; b++)
+                    colors[n++] = to_pixel(Color(r * 51, g * 51, b * 51));
+        for (int first = n; n < 256; n++) {
+            unsigned char v = (unsigned char) ((n - first) * 255 / (255 - first));
+            colors[n] = to_pixel(Color(v, v, v));
+        }
+    }
+
+    /// @brief Цвет с индексом i в формате пикселя buffer
+    uint32_t color(int i) const {
+        return colors[i];
+    }
+
+    /// @brief Индекс цвета палитры для пикселя buffer
+    uint8_t index(uint32_t pixel) {
+        const uint32_t p = pixel & 0xffffff;
+        const uint32_t slot = (p * 2654435761u) >> (32 - cache_bits);
+        if (cache_key[slot] != p + 1) {
+            cache_key[slot] = p + 1;
+            cache_index[slot] = uint8_t(nearest(p));
+        }
+        return cache_index[slot];
+    }
+};
+
+/// @brief LZW-сжатие индексов пикселей в формате GIF
+/// @details Словарь - хэш-таблица пар (код префикса, следующий индекс) с открытой адресацией.
+/// Когда коды кончаются (4095), в поток пишется код очистки и словарь начинается заново.
+class GifLzw {
+    static const int min_code_size = 8;
+    static const int clear_code = 1 << min_code_size;
+    static const int end_code = clear_code + 1;
+    static const int max_code = 4095;
+    static const int table_bits = 13;
+
+    int32_t keys[1 << table_bits]; ///< (префикс << 8) | индекс, -1 - пустая ячейка
+    uint16_t codes[1 << table_bits];
+    vector<uint8_t> packed; ///< Коды, упакованные в байты, до разбиения на блоки
+    uint32_t bit_buffer = 0;
+    int bit_count = 0;
+    int code_size = min_code_size + 1;
+    int next_code = end_code + 1;
+
+    static uint32_t slot_of(int32_t key) {
+        return (uint32_t(key) * 2654435761u) >> (32 - table_bits);
+    }
+
+    void reset_table() {
+        fill(begin(keys), end(keys), -1);
+        code_size = min_code_size + 1;
+        next_code = end_code + 1;
+    }
+
+    void put(int code) {
+        bit_buffer |= uint32_t(code) << bit_count;
+        bit_count += code_size;
+        while (bit_count >= 8) {
+            packed.push_back(uint8_t(bit_buffer));
+            bit_buffer >>= 8;
+            bit_count -= 8;
+        }
+        // декодер добавляет код в словарь на шаг позже, поэтому ширина растет после записи
+        if (next_code >= (1 << code_size) && code_size < 12)
+            code_size++;
+    }
+
+public:
+
+    /// @brief Сжать n индексов и дописать к out данные изображения GIF: размер кода и блоки по 255 байт
+    void encode(const uint8_t *data, size_t n, vector<uint8_t> &out) {
+        packed.clear();
+        bit_buffer = 0;
+        bit_count = 0;
+        reset_table();
+        put(clear_code);
+
+        int prefix = n > 0 ? data[0] : 0;
+        for (size_t i = 1; i < n; i++) {
+            const int32_t key = (prefix << 8) | data[i];
+            uint32_t slot = slot_of(key);
+            const uint32_t mask = (1u << table_bits) - 1;
+            while (keys[slot] != -1 && keys[slot] != key)
+                slot = (slot + 1) & mask;
+            if (keys[slot] == key) {
+                prefix = codes[slot];
+                continue;
+            }
+
+            put(prefix);
+            prefix = data[i];
+            if (next_code >= max_code) {
+                put(clear_code);
+                reset_table();
+            } else {
+                keys[slot] = key;
+                codes[slot] = uint16_t(next_code++);
+            }
+        }
+        put(prefix);
+        put(end_code);
+        if (bit_count > 0)
+            packed.push_back(uint8_t(bit_buffer));
+
+        out.push_back(min_code_size);
+        for (size_t i = 0; i < packed.size(); i += 255) {
+            const size_t len = min(packed.size() - i, size_t(255));
+            out.push_back(uint8_t(len));
+            out.insert(out.end(), packed.begin() + i, packed.begin() + i + len);
+        }
+        out.push_back(0);
+    }
+};
+
+/// @brief Файл GIF89a с бесконечным повтором анимации
+/// @details Каждый кадр - прямоугольник, изменившийся относительно предыдущего, поверх него (disposal 1).
+/// Задержка кадра известна только с приходом следующего, поэтому последний кадр держится в памяти.
+class GifWriter {
+    ofstream out;
+    vector<uint8_t> pending; ///< Дескриптор и данные последнего кадра
+    double pending_time = 0; ///< Время показа последнего кадра, с
+    vector<uint8_t> bytes;
+
+    void put16(vector<uint8_t> &to, int value) {
+        to.push_back(uint8_t(value));
+        to.push_back(uint8_t(value >> 8));
+    }
+
+    void write_pending(double until) {
+        if (pending.empty())
+            return;
+        // задержка в сотых долях секунды, округляются моменты, а не длительности: ошибка не накапливается;
+        // задержку меньше 2 браузеры показывают как 10
+        const long delay = max(2L, lround(until * 100) - lround(pending_time * 100));
+        const uint8_t control[] = {0x21, 0xf9, 4, 1 << 2, uint8_t(min(delay, 0xffffL)),
+                                   uint8_t(min(delay, 0xffffL) >> 8), 0, 0};
+        out.write((const char *) control, sizeof(control));
+        out.write((const char *) pending.data(), streamsize(pending.size()));
+        pending.clear();
+    }
+
+public:
+
+    GifWriter(const string &path, int width, int height, const GifPalette &palette) :
+            out(path, ios::binary | ios::trunc) {
+        if (!out)
+            throw runtime_error("Cannot open GIF file for writing: " + path);
+
+        bytes.assign({'G', 'I', 'F', '8', '9', 'a'});
+        put16(bytes, width);
+        put16(bytes, height);
+        bytes.insert(bytes.end(), {0xf7, 0, 0}); // глобальная палитра из 256 цветов, фон - индекс 0
+        for (int i = 0; i < 256; i++) {
+            const uint32_t c = palette.color(i);
+            bytes.insert(bytes.end(), {uint8_t(c >> 16), uint8_t(c >> 8), uint8_t(c)});
+        }
+        const char loop[] = "\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00";
+        bytes.insert(bytes.end(), loop, loop + sizeof(loop) - 1);
+        out.write((const char *) bytes.data(), streamsize(bytes.size()));
+    }
+
+    /// @brief Добавить кадр: область rect логического экрана с индексами цветов pixels, показанная в момент time
+    /// @param lzw Кодировщик, которым сжимаются индексы
+    void frame(const Rect &rect, const uint8_t *pixels, double time, GifLzw &lzw) {
+        write_pending(time);
+        pending.push_back(0x2c);
+        put16(pending, rect.x0);
+        put16(pending, rect.y0);
+        put16(pending, rect.x1 - rect.x0);
+        put16(pending, rect.y1 - rect.y0);
+        pending.push_back(0);
+        lzw.encode(pixels, size_t(rect.x1 - rect.x0) * size_t(rect.y1 - rect.y0), pending);
+        pending_time = time;
+    }
+
+    /// @brief Записать последний кадр, показываемый до момента end, и завершить файл
+    /// @return false - если при записи файла была ошибка
+    bool close(double end) {
+        write_pending(end);
+        out.put(0x3b);
+        out.close();
+        return !out.fail();
+    }
+};
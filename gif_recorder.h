@@ -0,0 +1,218 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include "gif.h"
+
+/// @brief Запись кадров игры в GIF в фоновом потоке
+/// @details Поток отрисовки только копирует buffer в свободный слот кольца кадров. Фоновый поток переводит
+/// кадр в индексы палитры, вырезает прямоугольник, изменившийся относительно предыдущего кадра, и сжимает его LZW.
+/// Кадры берутся не чаще fps раз в секунду времени игры, поэтому при воспроизведении без окна запись
+/// не зависит от скорости машины. Если кольцо заполнено, кадр пропускается, а в режиме без потерь
+/// поток отрисовки ждет, пока фоновый поток освободит слот.
+class GifRecorder {
+    struct Frame {
+        vector<uint32_t> pixels;
+        double time = 0;
+    };
+
+    const int scale; ///< Во сколько раз GIF меньше экрана по каждой оси
+    const int width, height; ///< Размер GIF
+    const double period; ///< Интервал между кадрами, с
+    const bool lossless;
+    double next_time = 0; ///< Время игры, начиная с которого берется следующий кадр
+
+    vector<Frame> ring;
+    size_t head = 0; ///< Слот, в который пишется следующий кадр
+    size_t tail = 0; ///< Слот, который кодируется следующим
+    size_t count = 0; ///< Кадров в кольце
+    bool stop = false;
+    size_t captured = 0, dropped = 0;
+    mutex m;
+    condition_variable cv;
+
+    // состояние фонового потока
+    GifPalette palette;
+    GifLzw lzw;
+    GifWriter writer;
+    vector<uint32_t> previous; ///< Последний закодированный кадр экрана
+    bool has_previous = false;
+    vector<uint8_t> indices; ///< Индексы палитры вырезанной области
+    double last_time = 0;
+
+    thread worker; ///< Создается последним, когда остальные поля уже инициализированы
+
+    /// @brief Прямоугольник экрана, в котором кадры a и b различаются; пустой - если кадры равны
+    static Rect changed(const uint32_t *a, const uint32_t *b) {
+        const size_t row = SCREEN_WIDTH * sizeof(uint32_t);
+        int y0 = 0, y1 = SCREEN_HEIGHT;
+        while (y0 < y1 && memcmp(a + y0 * SCREEN_WIDTH, b + y0 * SCREEN_WIDTH, row) == 0)
+            y0++;
+        while (y1 > y0 && memcmp(a + (y1 - 1) * SCREEN_WIDTH, b + (y1 - 1) * SCREEN_WIDTH, row) == 0)
+            y1--;
+
+        int x0 = SCREEN_WIDTH, x1 = 0;
+        for (int y = y0; y < y1; y++) {
+            const uint32_t *ra = a + y * SCREEN_WIDTH, *rb = b + y * SCREEN_WIDTH;
+            int l = 0, r = SCREEN_WIDTH;
+            while (l < x0 && ra[l] == rb[l])
+                l++;
+            while (r > max(x1, l) && ra[r - 1] == rb[r - 1])
+                r--;
+            x0 = min(x0, l);
+            x1 = max(x1, r);
+        }
+        if (x0 >= x1)
+            return {0, 0, 0, 0};
+        return {x0, y0, x1, y1};
+    }
+
+    void encode(Frame &frame) {
+        Rect rect = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        if (has_previous)
+            rect = changed(frame.pixels.data(), previous.data());
+
+        // область в координатах GIF: каждый scale-й пиксель каждой scale-й строки
+        Rect out = {rect.x0 / scale, rect.y0 / scale,
+                    min(width, (rect.x1 + scale - 1) / scale), min(height, (rect.y1 + scale - 1) / scale)};
+        if (out.x0 < out.x1 && out.y0 < out.y1) {
+            indices.resize(size_t(out.x1 - out.x0) * size_t(out.y1 - out.y0));
+            uint8_t *dst = indices.data();
+            uint32_t last_pixel = ~0u;
+            uint8_t last_index = 0;
+            for (int y = out.y0; y < out.y1; y++) {
+                const uint32_t *src = frame.pixels.data() + size_t(y) * scale * SCREEN_WIDTH;
+                for (int x = out.x0; x < out.x1; x++) {
+                    const uint32_t p = src[x * scale];
+                    if (p != last_pixel) {
+                        last_pixel = p;
+                        last_index = palette.index(p);
+                    }
+                    *dst++ = last_index;
+                }
+            }
+            writer.frame(out, indices.data(), frame.time, lzw);
+        }
+        last_time = frame.time;
+
+        // кольцо получает буфер предыдущего кадра, копирования нет
+        swap(frame.pixels, previous);
+        has_previous = true;
+    }
+
+    void loop() {
+        PROFILE_THREAD("gif encoder");
+        unique_lock<mutex> lock(m);
+        for (;;) {
+            cv.wait(lock, [&] { return stop || count > 0; });
+            if (count == 0)
+                return;
+
+            Frame &frame = ring[tail];
+            lock.unlock();
+            {
+                PROFILE_SCOPE("gif_encode");
+                encode(frame);
+            }
+            lock.lock();
+
+            tail = (tail + 1) % ring.size();
+            count--;
+            cv.notify_all();
+        }
+    }
+
+    /// @brief scale, если настройки допустимы, иначе исключение; вызывается до деления на scale и открытия файла
+    static int checked_scale(double fps, int scale, size_t slots) {
+        if (!valid_settings(fps, scale, slots))
+            throw runtime_error("Invalid GIF recorder settings");
+        return scale;
+    }
+
+public:
+
+    /// @brief Допустимы ли настройки конструктора
+    static bool valid_settings(double fps, int scale, size_t slots = 4) {
+        return fps > 0 && fps <= 50 && scale >= 1 && scale <= SCREEN_WIDTH && slots > 0;
+    }
+
+    /// @param path Файл GIF
+    /// @param fps Наибольшая частота кадров GIF по времени игры, не больше 50
+    /// @param scale Уменьшение экрана в целое число раз по каждой оси
+    /// @param lossless Не пропускать кадры: ждать фоновый поток, если кольцо заполнено
+    /// @param slots Размер кольца кадров
+    GifRecorder(const string &path, double fps, int scale, bool lossless, size_t slots = 4) :
+            scale(checked_scale(fps, scale, slots)), width(SCREEN_WIDTH / scale), height(SCREEN_HEIGHT / scale),
+            period(1 / fps), lossless(lossless), ring(slots),
+            writer(path, SCREEN_WIDTH / scale, SCREEN_HEIGHT / scale, palette),
+            previous(size_t(SCREEN_WIDTH) * SCREEN_HEIGHT) {
+        for (auto &frame: ring)
+            frame.pixels.resize(size_t(SCREEN_WIDTH) * SCREEN_HEIGHT);
+        worker = thread(&GifRecorder::loop, this);
+    }
+
+    GifRecorder(const GifRecorder &) = delete;
+
+    GifRecorder &operator=(const GifRecorder &) = delete;
+
+    /// @brief Передать кадр buffer, показанный в момент time игры; вызывается после draw()
+    void capture(double time) {
+        // время игры - сумма шагов float, допуск не дает пропустить кадр из-за ошибки округления
+        if (time + 1e-6 < next_time)
+            return;
+        next_time += period;
+        if (next_time <= time)
+            next_time = time + period;
+
+        unique_lock<mutex> lock(m);
+        if (count == ring.size()) {
+            if (!lossless) {
+                dropped++;
+                return;
+            }
+            cv.wait(lock, [&] { return count < ring.size(); });
+        }
+        // слот head не трогает фоновый поток, пока он не добавлен в кольцо
+        Frame &frame = ring[head];
+        lock.unlock();
+        PROFILE_SCOPE("gif_capture");
+        memcpy(frame.pixels.data(), buffer, frame.pixels.size() * sizeof(uint32_t));
+        frame.time = time;
+        lock.lock();
+
+        head = (head + 1) % ring.size();
+        count++;
+        captured++;
+        cv.notify_all();
+    }
+
+    /// @brief Кадров передано в фоновый поток
+    size_t frames() const {
+        return captured;
+    }
+
+    /// @brief Кадров пропущено из-за заполненного кольца
+    size_t dropped_frames() const {
+        return dropped;
+    }
+
+    /// @brief Дождаться кодирования всех кадров и завершить файл
+    /// @return false - если при записи файла была ошибка
+    bool close() {
+        if (!worker.joinable())
+            return true;
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        cv.notify_all();
+        worker.join();
+        return writer.close(last_time + period);
+    }
+
+    ~GifRecorder() {
+        close();
+    }
+};
@@ -0,0 +1,106 @@
+#include "kernels.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+static void fill_span_scalar(uint32_t *dst, size_t n, uint32_t value) {
+    for (size_t i = 0; i < n; i++)
+        dst[i] = value;
+}
+
+static void copy_span_scalar(uint32_t *dst, const uint32_t *src, size_t n) {
+    memcpy(dst, src, n * sizeof(uint32_t));
+}
+
+#ifdef HAVE_X86_KERNELS
+
+__attribute__((target("sse2")))
+static void fill_span_sse2(uint32_t *dst, size_t n, uint32_t value) {
+    const __m128i v = _mm_set1_epi32(int(value));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_si128((__m128i *) (dst + i), v);
+    fill_span_scalar(dst + i, n - i, value);
+}
+
+__attribute__((target("sse2")))
+static void copy_span_sse2(uint32_t *dst, const uint32_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_loadu_si128((const __m128i *) (src + i)));
+    copy_span_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void fill_span_avx2(uint32_t *dst, size_t n, uint32_t value) {
+    const __m256i v = _mm256_set1_epi32(int(value));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_si256((__m256i *) (dst + i), v);
+    fill_span_scalar(dst + i, n - i, value);
+}
+
+__attribute__((target("avx2")))
+static void copy_span_avx2(uint32_t *dst, const uint32_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_loadu_si256((const __m256i *) (src + i)));
+    copy_span_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void fill_span_avx512(uint32_t *dst, size_t n, uint32_t value) {
+    const __m512i v = _mm512_set1_epi32(int(value));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_si512(dst + i, v);
+    if (i < n)
+        _mm512_mask_storeu_epi32(dst + i, __mmask16((1u << (n - i)) - 1), v);
+}
+
+__attribute__((target("avx512f")))
+static void copy_span_avx512(uint32_t *dst, const uint32_t *src, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_si512(dst + i, _mm512_loadu_si512(src + i));
+    if (i < n) {
+        __mmask16 tail = __mmask16((1u << (n - i)) - 1);
+        _mm512_mask_storeu_epi32(dst + i, tail, _mm512_maskz_loadu_epi32(tail, src + i));
+    }
+}
+
+#endif
+
+static const PixelKernels scalar_kernels = {"scalar", fill_span_scalar, copy_span_scalar};
+#ifdef HAVE_X86_KERNELS
+static const PixelKernels sse2_kernels = {"sse2", fill_span_sse2, copy_span_sse2};
+static const PixelKernels avx2_kernels = {"avx2", fill_span_avx2, copy_span_avx2};
+static const PixelKernels avx512_kernels = {"avx512", fill_span_avx512, copy_span_avx512};
+#endif
+
+static const PixelKernels &select_kernels() {
+    const char *forced = getenv("GAME_KERNELS");
+    auto allowed = [&](const char *name) {
+        return !forced || strcmp(forced, name) == 0;
+    };
+
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (allowed("avx512") && __builtin_cpu_supports("avx512f"))
+        return avx512_kernels;
+    if (allowed("avx2") && __builtin_cpu_supports("avx2"))
+        return avx2_kernels;
+    if (allowed("sse2") && __builtin_cpu_supports("sse2"))
+        return sse2_kernels;
+#endif
+    return scalar_kernels;
+}
+
+const PixelKernels &pixel_kernels() {
+    static const PixelKernels &selected = select_kernels();
+    return selected;
+}
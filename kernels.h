@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Engine.h"
+
+/// @brief Векторизованные примитивы заливки и копирования пикселей
+/// @details Варианты для SSE2, AVX2 и AVX-512 выбираются один раз при запуске по CPUID,
+/// переменная окружения GAME_KERNELS (scalar, sse2, avx2, avx512) позволяет выбрать вариант вручную.
+struct PixelKernels {
+    const char *name;
+
+    /// @brief dst[i] = value для i из [0, n)
+    void (*fill_span)(uint32_t *dst, size_t n, uint32_t value);
+
+    /// @brief dst[i] = src[i] для i из [0, n), области не пересекаются
+    void (*copy_span)(uint32_t *dst, const uint32_t *src, size_t n);
+};
+
+/// @brief Набор примитивов, выбранный для текущего процессора
+const PixelKernels &pixel_kernels();
+
+inline void fill_span(uint32_t *dst, size_t n, uint32_t value) {
+    pixel_kernels().fill_span(dst, n, value);
+}
+
+inline void copy_span(uint32_t *dst, const uint32_t *src, size_t n) {
+    pixel_kernels().copy_span(dst, src, n);
+}
+
+/// @brief Заливка прямоугольника r в buffer
+inline void fill_rect(const Rect &r, uint32_t value) {
+    if (r.x0 >= r.x1)
+        return;
+    auto &k = pixel_kernels();
+    for (int y = r.y0; y < r.y1; y++)
+        k.fill_span(buffer[y] + r.x0, size_t(r.x1 - r.x0), value);
+}
+
+/// @brief Копирование прямоугольника r в buffer из кадра src той же ширины
+inline void copy_rect(const Rect &r, const uint32_t *src) {
+    if (r.x0 >= r.x1)
+        return;
+    auto &k = pixel_kernels();
+    for (int y = r.y0; y < r.y1; y++)
+        k.copy_span(buffer[y] + r.x0, src + size_t(y) * SCREEN_WIDTH + r.x0, size_t(r.x1 - r.x0));
+}
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <type_traits>
 #include <vector>
 #include <cmath>
+#include <stdexcept>
 
 template<class T>
 inline T circle_idx(T i, T n) {
@@ -11,24 +14,61 @@ inline T circle_idx(T i, T n) {
     return i - n;
 }
 
-vector<int> get_comb_coeffs(int n) {
-    if (n == 1)
-        return {1};
-    if (n == 4)
-        return {1, 3, 3, 1}; // самый частый случай при вызове, небольшая оптимизация
+/// @brief Наибольшая степень многочлена Бернштейна, для которой есть таблица коэффициентов
+constexpr int max_bernstein_degree = 15;
 
-    vector<int> coeffs(n);
-    coeffs[0] = 1;
-    coeffs.back() = 1;
-    for (int i = 1; i < n / 2; i++) {
-        coeffs[i] = coeffs[i - 1] * (n - i) / i;
-        coeffs[n - i - 1] = coeffs[i];
+/// @brief Биномиальные коэффициенты C(n, k) для n до max_bernstein_degree, строятся при компиляции
+struct BinomialTable {
+    int c[max_bernstein_degree + 1][max_bernstein_degree + 1] = {};
+
+    constexpr BinomialTable() {
+        for (int n = 0; n <= max_bernstein_degree; n++) {
+            c[n][0] = c[n][n] = 1;
+            for (int k = 1; k < n; k++)
+                c[n][k] = c[n - 1][k - 1] + c[n - 1][k];
+        }
     }
-    if (n % 2 != 0) {
-        coeffs[n / 2] = coeffs[n / 2 - 1] * (n - n / 2) / (n / 2);
+};
+
+constexpr BinomialTable binomial_table;
+
+constexpr int binomial(int n, int k) {
+    return binomial_table.c[n][k];
+}
+
+/// @brief Коэффициенты многочленов Бернштейна для кривой из n точек: C(n - 1, i)
+/// @return Строка таблицы из n чисел, без выделения памяти
+inline const int *bernstein_coeffs(int n) {
+    if (n < 1 || n > max_bernstein_degree + 1)
+        throw runtime_error("Bezier curve must have from 1 to 16 points");
+
+    return binomial_table.c[n - 1];
+}
+
+/// @brief Начальное значение хэша FNV-1a
+const uint64_t fnv_offset_basis = 14695981039346656037ull;
+
+/// @brief Продолжить хэш FNV-1a байтами data
+inline uint64_t fnv1a(uint64_t h, const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
     }
+    return h;
+}
+
+/// @brief Продолжить хэш побайтовым представлением значения: одинаковые биты - одинаковый хэш
+template<class T>
+inline uint64_t hash_bytes(uint64_t h, const T &value) {
+    static_assert(is_trivially_copyable<T>::value, "Value must be trivially copyable");
+    return fnv1a(h, &value, sizeof(value));
+}
 
-    return coeffs;
+template<class T, class Alloc>
+inline uint64_t hash_bytes(uint64_t h, const vector<T, Alloc> &values) {
+    static_assert(is_trivially_copyable<T>::value, "Value must be trivially copyable");
+    return fnv1a(h, values.data(), values.size() * sizeof(T));
 }
 
 template<class T>
@@ -41,3 +81,17 @@ int sign(T n) {
 
     return 0;
 }
+
+/// @brief Косинус и синус небольшого угла phi многочленами Тейлора, без вызовов libm
+/// @details Повороты за шаг симуляции или его часть - сотые доли радиана; для |phi| <= 0.5 ошибка меньше 3e-10.
+/// Большие углы (очень длинный шаг) считаются через cos и sin.
+inline void small_angle_rotor(double phi, double &c, double &s) {
+    if (fabs(phi) > 0.5) {
+        c = cos(phi);
+        s = sin(phi);
+        return;
+    }
+    const double p2 = phi * phi;
+    c = 1 - p2 / 2 * (1 - p2 / 12 * (1 - p2 / 30 * (1 - p2 / 56)));
+    s = phi * (1 - p2 / 6 * (1 - p2 / 20 * (1 - p2 / 42 * (1 - p2 / 72))));
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Engine.h"
+#include "profiler.h"
+
+/// @brief Поток симуляции для конвейерного режима
+/// @details act() следующего кадра выполняется в отдельном потоке, пока основной поток рисует
+/// и выводит текущий кадр. Состояние передается в draw() снимками (см. SnapshotBuffer),
+/// поэтому синхронизируются только начало и конец шага.
+class SimulationThread {
+    std::mutex m;
+    std::condition_variable cv;
+    float dt = 0;
+    int steps = 0;
+    bool pending = false; ///< Шаг запрошен и еще не выполнен
+    bool stop = false;
+    std::thread worker; ///< Создается последним, когда остальные поля уже инициализированы
+
+    void loop() {
+        PROFILE_THREAD("simulation");
+        std::unique_lock<std::mutex> lock(m);
+        for (;;) {
+            cv.wait(lock, [&] { return stop || pending; });
+            if (stop)
+                return;
+
+            float step = dt;
+            int count = steps;
+            lock.unlock();
+            for (int i = 0; i < count; i++)
+                act(step);
+            lock.lock();
+
+            pending = false;
+            cv.notify_all();
+        }
+    }
+
+public:
+
+    SimulationThread() : worker(&SimulationThread::loop, this) {}
+
+    SimulationThread(const SimulationThread &) = delete;
+
+    SimulationThread &operator=(const SimulationThread &) = delete;
+
+    /// @brief Начать count вызовов act(step) в потоке симуляции
+    void start(float step, int count = 1) {
+        std::lock_guard<std::mutex> lock(m);
+        dt = step;
+        steps = count;
+        pending = true;
+        cv.notify_all();
+    }
+
+    /// @brief Дождаться окончания шага
+    void wait() {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&] { return !pending; });
+    }
+
+    ~SimulationThread() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stop = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+};
@@ -0,0 +1,293 @@
+#pragma once
+
+//
+//  Замер времени участков кода: PROFILE_SCOPE("name") замеряет время до конца блока.
+//  Собирается только с макросом GAME_PROFILE (cmake -DGAME_PROFILE=ON), иначе макросы пустые.
+//  При выходе profile_report() печатает по каждому участку число вызовов, среднее, p50, p95, p99 и максимум;
+//  GAME_TRACE=file.json дополнительно записывает все замеры в формате Chrome trace event
+//  (chrome://tracing, Perfetto).
+//
+
+#ifdef GAME_PROFILE
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "frame_clock.h"
+
+using namespace std;
+
+/// @brief Гистограмма длительностей в наносекундах с логарифмическими корзинами
+/// @details Каждая степень двойки делится на 16 корзин, поэтому ошибка процентиля не больше 1/16,
+/// а память и время записи не зависят от числа замеров.
+class DurationHistogram {
+    static const int sub_bits = 4;
+    static const int sub_count = 1 << sub_bits;
+    static const int bucket_count = (64 - sub_bits + 1) * sub_count;
+
+    uint64_t buckets[bucket_count] = {};
+
+    static int bucket_of(uint64_t ns) {
+        if (ns < sub_count)
+            return int(ns);
+        const int e = 63 - __builtin_clzll(ns);
+        return (e - sub_bits + 1) * sub_count + int((ns >> (e - sub_bits)) & (sub_count - 1));
+    }
+
+    /// @brief Середина корзины, нс
+    static double value_of(int bucket) {
+        if (bucket < sub_count)
+            return bucket;
+        const int e = bucket / sub_count + sub_bits - 1;
+        const double lo = ldexp(double(sub_count + bucket % sub_count), e - sub_bits);
+        return lo + ldexp(0.5, e - sub_bits);
+    }
+
+public:
+
+    uint64_t count = 0;
+    uint64_t total = 0; ///< Сумма длительностей, нс
+    uint64_t max_ns = 0;
+
+    void add(uint64_t ns) {
+        buckets[bucket_of(ns)]++;
+        count++;
+        total += ns;
+        max_ns = max(max_ns, ns);
+    }
+
+    void merge(const DurationHistogram &other) {
+        for (int i = 0; i < bucket_count; i++)
+            buckets[i] += other.buckets[i];
+        count += other.count;
+        total += other.total;
+        max_ns = max(max_ns, other.max_ns);
+    }
+
+    /// @brief Длительность, которую не превышает доля q замеров, нс
+    double percentile(double q) const {
+        const uint64_t rank = uint64_t(ceil(q * double(count)));
+        uint64_t seen = 0;
+        for (int i = 0; i < bucket_count; i++) {
+            seen += buckets[i];
+            if (seen >= max<uint64_t>(rank, 1))
+                return min(value_of(i), double(max_ns));
+        }
+        return double(max_ns);
+    }
+};
+
+/// @brief Все замеры программы: участки, потоки и их гистограммы и события трассы
+class Profiler {
+    /// @brief Событие трассы: участок выполнялся с start в течение duration нс; duration < 0 - значение счетчика
+    struct Event {
+        uint64_t start;
+        int64_t duration;
+        int site;
+    };
+
+    struct ThreadData {
+        string name;
+        vector<unique_ptr<DurationHistogram>> histograms; ///< По номеру участка
+        vector<Event> events;
+        vector<int64_t> values; ///< Значения счетчиков, по одному на событие счетчика
+        bool truncated = false; ///< Часть событий не поместилась в трассу
+    };
+
+    static const size_t max_thread_events = 1 << 20; ///< Дальше трасса потока обрезается, гистограммы пишутся
+
+    mutex m;
+    vector<const char *> sites;
+    vector<unique_ptr<ThreadData>> threads; ///< Переживают свои потоки: отчет строится при выходе
+    uint64_t origin = monotonic_nsec();
+    const char *trace_path = getenv("GAME_TRACE");
+
+    static inline thread_local ThreadData *current = nullptr;
+
+    ThreadData &thread_data() {
+        if (!current) {
+            lock_guard<mutex> lock(m);
+            threads.push_back(make_unique<ThreadData>());
+            current = threads.back().get();
+            current->name = "thread " + to_string(threads.size() - 1);
+        }
+        return *current;
+    }
+
+    void push_event(ThreadData &data, const Event &event) {
+        if (!trace_path)
+            return;
+        if (data.events.size() < max_thread_events)
+            data.events.push_back(event);
+        else
+            data.truncated = true;
+    }
+
+    void write_trace() {
+        FILE *f = fopen(trace_path, "w");
+        if (!f) {
+            fprintf(stderr, "Cannot open trace file for writing: %s\n", trace_path);
+            return;
+        }
+        fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        const char *separator = "";
+        bool truncated = false;
+        for (size_t tid = 0; tid < threads.size(); tid++) {
+            const ThreadData &data = *threads[tid];
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                    separator, tid, data.name.c_str());
+            separator = ",\n";
+            size_t value = 0;
+            truncated = truncated || data.truncated;
+            for (const Event &e: data.events) {
+                const double ts = double(e.start - origin) * 1e-3;
+                if (e.duration >= 0)
+                    fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+                            sites[e.site], tid, ts, double(e.duration) * 1e-3);
+                else
+                    fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,"
+                               "\"args\":{\"value\":%lld}}", sites[e.site], tid, ts, (long long) data.values[value++]);
+            }
+        }
+        fprintf(f, "\n]}\n");
+        fclose(f);
+        printf("trace: %s%s\n", trace_path, truncated ? " (truncated)" : "");
+    }
+
+public:
+
+    static Profiler &instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    /// @brief Зарегистрировать участок, name - строковый литерал
+    /// @details Участки с одним именем, например в разных экземплярах шаблона, замеряются вместе.
+    int add_site(const char *name) {
+        lock_guard<mutex> lock(m);
+        for (size_t s = 0; s < sites.size(); s++)
+            if (strcmp(sites[s], name) == 0)
+                return int(s);
+        sites.push_back(name);
+        return int(sites.size() - 1);
+    }
+
+    /// @brief Имя текущего потока в трассе
+    void name_thread(const char *name) {
+        thread_data().name = name;
+    }
+
+    /// @brief Учесть выполнение участка site с момента start до end
+    void record(int site, uint64_t start, uint64_t end) {
+        ThreadData &data = thread_data();
+        if (data.histograms.size() <= size_t(site))
+            data.histograms.resize(site + 1);
+        if (!data.histograms[site])
+            data.histograms[site] = make_unique<DurationHistogram>();
+        data.histograms[site]->add(end - start);
+        push_event(data, {start, int64_t(end - start), site});
+    }
+
+    /// @brief Записать в трассу значение счетчика site
+    void counter(int site, int64_t value) {
+        ThreadData &data = thread_data();
+        if (trace_path && data.events.size() < max_thread_events)
+            data.values.push_back(value);
+        push_event(data, {monotonic_nsec(), -1, site});
+    }
+
+    /// @brief Напечатать гистограммы участков и записать трассу
+    /// @details Вызывается, когда замеряемые потоки уже не работают.
+    void report() {
+        lock_guard<mutex> lock(m);
+        vector<DurationHistogram> merged(sites.size());
+        for (auto &data: threads)
+            for (size_t s = 0; s < data->histograms.size(); s++)
+                if (data->histograms[s])
+                    merged[s].merge(*data->histograms[s]);
+
+        vector<size_t> order;
+        for (size_t s = 0; s < sites.size(); s++)
+            if (merged[s].count > 0)
+                order.push_back(s);
+        // сначала участки с наибольшим суммарным временем
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) { return merged[a].total > merged[b].total; });
+
+        printf("%-16s %10s %10s %10s %10s %10s %10s %10s\n", "scope", "count", "total, ms", "mean, us",
+               "p50, us", "p95, us", "p99, us", "max, us");
+        for (size_t s: order) {
+            const DurationHistogram &h = merged[s];
+            printf("%-16s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", sites[s], (unsigned long long) h.count,
+                   double(h.total) * 1e-6, double(h.total) / double(h.count) * 1e-3, h.percentile(0.5) * 1e-3,
+                   h.percentile(0.95) * 1e-3, h.percentile(0.99) * 1e-3, double(h.max_ns) * 1e-3);
+        }
+
+        if (trace_path)
+            write_trace();
+    }
+};
+
+/// @brief Участок кода, замеряемый ProfileScope
+class ProfileSite {
+public:
+    const int id;
+
+    explicit ProfileSite(const char *name) : id(Profiler::instance().add_site(name)) {}
+};
+
+/// @brief Замер времени от создания до конца блока
+class ProfileScope {
+    const ProfileSite &site;
+    const uint64_t start;
+
+public:
+
+    explicit ProfileScope(const ProfileSite &site) : site(site), start(monotonic_nsec()) {}
+
+    ProfileScope(const ProfileScope &) = delete;
+
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+    ~ProfileScope() {
+        Profiler::instance().record(site.id, start, monotonic_nsec());
+    }
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+/// Замерить время до конца блока, name - строковый литерал
+#define PROFILE_SCOPE(name) \
+    static const ProfileSite PROFILE_CONCAT(profile_site_, __LINE__)(name); \
+    ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(PROFILE_CONCAT(profile_site_, __LINE__))
+
+/// Записать в трассу значение счетчика
+#define PROFILE_COUNTER(name, value) do { \
+        static const ProfileSite profile_counter_site(name); \
+        Profiler::instance().counter(profile_counter_site.id, int64_t(value)); \
+    } while (false)
+
+/// Назвать текущий поток в трассе
+#define PROFILE_THREAD(name) Profiler::instance().name_thread(name)
+
+/// @brief Напечатать отчет о замерах и записать трассу
+inline void profile_report() {
+    Profiler::instance().report();
+}
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNTER(name, value) do {} while (false)
+#define PROFILE_THREAD(name)
+
+inline void profile_report() {}
+
+#endif
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include "Engine.h"
+
+using namespace std;
+
+/// @brief Формат записи ввода
+/// @details Заголовок: "GRPL", версия (1 байт), зерно (4 байта), длина шага act() в секундах (float, 4 байта).
+/// Дальше записи шагов по порядку: события клавиш шага - тег 'K', номер шага (varint), клавиша и состояние
+/// (1 байт: код VK | нажата << 7), затем конец шага - тег 'H' и 32 бита хэша состояния после шага.
+/// Числа записываются в порядке little-endian.
+namespace replay_format {
+    const char magic[4] = {'G', 'R', 'P', 'L'};
+    const uint8_t version = 1;
+    const char key_tag = 'K';
+    const char hash_tag = 'H';
+    const int keys[] = {VK_SPACE, VK_RETURN}; ///< Записываемые клавиши
+}
+
+/// @brief Запись зерна, нажатий клавиш и хэшей состояния каждого шага в файл
+class InputRecorder {
+    ofstream out;
+    float step; ///< Длина шага
+    uint64_t tick = 0;
+    bool keys[VK__COUNT] = {};
+
+    void put(uint32_t value, int bytes) {
+        for (int i = 0; i < bytes; i++)
+            out.put(char(value >> (8 * i)));
+    }
+
+    void put_varint(uint64_t value) {
+        while (value >= 0x80) {
+            out.put(char(value | 0x80));
+            value >>= 7;
+        }
+        out.put(char(value));
+    }
+
+public:
+
+    /// @param step Длина шага act(); заголовок пишется сразу, и запись без шагов тоже воспроизводится
+    InputRecorder(const string &path, uint32_t seed, float step) : out(path, ios::binary | ios::trunc), step(step) {
+        if (!(step > 0))
+            throw runtime_error("Recording requires a simulation step greater than zero");
+        if (!out)
+            throw runtime_error("Cannot open replay file for writing: " + path);
+
+        out.write(replay_format::magic, sizeof(replay_format::magic));
+        out.put(char(replay_format::version));
+        put(seed, 4);
+        uint32_t bits;
+        memcpy(&bits, &step, sizeof(bits));
+        put(bits, 4);
+        out.flush();
+    }
+
+    /// @brief Записать шаг: изменения состояния клавиш до шага и хэш состояния после него
+    /// @param pressed Состояние клавиш, по которому сделан шаг
+    void record(float dt, const bool pressed[VK__COUNT], uint64_t hash) {
+        if (dt != step)
+            throw runtime_error("Recording requires a fixed simulation step");
+
+        for (int vk: replay_format::keys) {
+            if (pressed[vk] == keys[vk])
+                continue;
+            keys[vk] = pressed[vk];
+            out.put(replay_format::key_tag);
+            put_varint(tick);
+            out.put(char(vk | (pressed[vk] ? 0x80 : 0)));
+        }
+        out.put(replay_format::hash_tag);
+        put(uint32_t(hash ^ (hash >> 32)), 4);
+        tick++;
+    }
+
+    /// @brief Дописать буферизованные данные в файл
+    void flush() {
+        out.flush();
+    }
+};
+
+/// @brief Воспроизведение файла InputRecorder: нажатия клавиш по шагам и проверка хэшей состояния
+class InputReplay {
+    ifstream in;
+    uint32_t run_seed = 0;
+    float run_step = 0;
+    uint64_t tick = 0;
+    uint32_t expected = 0; ///< Хэш, который должен получиться после текущего шага
+    bool keys[VK__COUNT] = {};
+
+    uint32_t get(int bytes) {
+        uint32_t value = 0;
+        for (int i = 0; i < bytes; i++)
+            value |= uint32_t(uint8_t(in.get())) << (8 * i);
+        return value;
+    }
+
+    uint64_t get_varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = in.get();
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+        return value;
+    }
+
+public:
+
+    explicit InputReplay(const string &path) : in(path, ios::binary) {
+        if (!in)
+            throw runtime_error("Cannot open replay file: " + path);
+
+        char magic[sizeof(replay_format::magic)];
+        in.read(magic, sizeof(magic));
+        if (!in || memcmp(magic, replay_format::magic, sizeof(magic)) != 0)
+            throw runtime_error("Not a replay file: " + path);
+        if (uint8_t(in.get()) != replay_format::version)
+            throw runtime_error("Unsupported replay version: " + path);
+        run_seed = get(4);
+        uint32_t bits = get(4);
+        memcpy(&run_step, &bits, sizeof(bits));
+        if (!in || !(run_step > 0))
+            throw runtime_error("Corrupted replay header: " + path);
+    }
+
+    /// @brief Зерно записанного запуска
+    uint32_t seed() const {
+        return run_seed;
+    }
+
+    /// @brief Длина шага записанного запуска, с
+    float step() const {
+        return run_step;
+    }
+
+    /// @brief Номер следующего шага
+    uint64_t ticks() const {
+        return tick;
+    }
+
+    /// @brief Прочитать ввод следующего шага
+    /// @param pressed Сюда записывается состояние записанных клавиш
+    /// @return false - если запись кончилась
+    bool next(bool pressed[VK__COUNT]) {
+        for (;;) {
+            int tag = in.get();
+            if (tag == EOF)
+                return false;
+            if (tag == replay_format::hash_tag) {
+                expected = get(4);
+                if (!in)
+                    return false;
+                break;
+            }
+            if (tag != replay_format::key_tag || get_varint() != tick)
+                throw runtime_error("Corrupted replay record at tick " + to_string(tick));
+            int code = in.get();
+            if ((code & 0x7f) < VK__COUNT)
+                keys[code & 0x7f] = (code & 0x80) != 0;
+        }
+
+        for (int vk: replay_format::keys)
+            pressed[vk] = keys[vk];
+        tick++;
+        return true;
+    }
+
+    /// @brief Совпадает ли хэш состояния после шага с записанным
+    bool check(uint64_t hash) const {
+        return uint32_t(hash ^ (hash >> 32)) == expected;
+    }
+};
@@ -10,6 +10,9 @@ class Rotator {
     double r; ///< Радиус круга
     double w; ///< Угловая скорость вращения кругов
     vector<Circle> circles; ///< Круги
+    vector<Vertex<double>> offsets; ///< Положения кругов относительно центра при нулевом угле
+    double angle = 0; ///< Угол поворота, [-pi, pi]
+    double angle_error = 0; ///< Потерянные при сложении младшие разряды угла (суммирование Кэхэна)
     bool forward = true; ///< Направление вращения
 
 public:
@@ -27,6 +30,7 @@ public:
         }
 
         circles.resize(count);
+        offsets.resize(count);
         double interval = 2 * M_PI / count;
         for (int i = 0; i < count; i++) {
             double phi = interval * i;
@@ -34,7 +38,8 @@ public:
             double x = R * cos(phi);
             double y = R * sin(phi);
 
-            circles[i] = Circle(center + Vertex<double>(x, y), r);
+            offsets[i] = Vertex<double>(x, y);
+            circles[i] = Circle(center + offsets[i], r);
         }
     }
 
@@ -44,18 +49,27 @@ public:
     }
 
     /// @brief Вращать круги
+    /// @details Накапливается только угол, положения кругов вычисляются по нему заново одним синусом
+    /// и косинусом на все круги, поэтому ошибка округления не копится в радиусе и фазе орбиты.
     void rotate(double dt) {
         double phi = w * dt;
         if (!forward) {
             phi = -phi;
         }
-        double cos_phi = cos(phi), sin_phi = sin(phi);
-        for (auto &circle: circles) {
-            auto vec = circle.center - center;
+        const double add = phi - angle_error, sum = angle + add;
+        angle_error = (sum - angle) - add;
+        angle = sum;
+        if (angle > M_PI)
+            angle -= 2 * M_PI;
+        else if (angle < -M_PI)
+            angle += 2 * M_PI;
+        double cos_phi = cos(angle), sin_phi = sin(angle);
+        for (size_t i = 0; i < circles.size(); i++) {
+            const Vertex<double> &vec = offsets[i];
             double x = vec.x * cos_phi - vec.y * sin_phi;
             double y = vec.x * sin_phi + vec.y * cos_phi;
 
-            circle.center = center + Vertex<double>(x, y);
+            circles[i].center = center + Vertex<double>(x, y);
         }
     }
 
@@ -65,10 +79,32 @@ public:
             circle.fill(color);
     }
 
+
+    /// @brief Центр вращения
+    const Vertex<double> &get_center() const {
+        return center;
+    }
+
+    /// @brief Угловая скорость кругов со знаком направления вращения
+    double get_angular_velocity() const {
+        return forward ? w : -w;
+    }
+
     const vector<Circle> &get_circles() const {
         return circles;
     }
 
+    /// @brief Продолжить хэш h состоянием вращения и положениями кругов
+    uint64_t hash(uint64_t h) const {
+        h = hash_bytes(h, angle);
+        h = hash_bytes(h, angle_error);
+        h = hash_bytes(h, w);
+        h = hash_bytes(h, forward);
+        for (auto &circle: circles)
+            h = hash_bytes(h, circle.center);
+        return h;
+    }
+
     /// @brief Ускорение вращения в alpha раз
     void up_w(double alpha) {
         w *= alpha;
@@ -11,7 +11,7 @@ class Scoreboard {
     const int skip = w / 4; ///< Интервал между цифрами
     Vertex<int> left_up = {int(0.8 * SCREEN_WIDTH), bounds_size + skip + 2}; ///< Точка, откуда начинают рисоваться цифры
 
-    vector<Vertex<int>> number_0() {
+    vector<Vertex<int>> number_0() const {
         return vector<Vertex<int>>{
                 {w, 0},
                 {0, 0},
@@ -21,7 +21,7 @@ class Scoreboard {
         };
     }
 
-    vector<Vertex<int>> number_1() {
+    vector<Vertex<int>> number_1() const {
         return vector<Vertex<int>>{
                 {w / 2, h_2 - 10},
                 {w,     0},
@@ -29,7 +29,7 @@ class Scoreboard {
         };
     }
 
-    vector<Vertex<int>> number_2() {
+    vector<Vertex<int>> number_2() const {
         return vector<Vertex<int>>{
                 {0, 0},
                 {w, 0},
@@ -40,7 +40,7 @@ class Scoreboard {
         };
     }
 
-    vector<Vertex<int>> number_3() {
+    vector<Vertex<int>> number_3() const {
         return vector<Vertex<int>>{
                 {0, 0},
                 {w, 0},
@@ -52,7 +52,7 @@ class Scoreboard {
         };
     }
 
-    vector<Vertex<int>> number_4() {
+    vector<Vertex<int>> number_4() const {
         return vector<Vertex<int>>{
                 {0, 0},
                 {0, h_2},
@@ -62,7 +62,7 @@ class Scoreboard {
         };
     }
 
-    vector<Vertex<int>> number_5() {
+    vector<Vertex<int>> number_5() const {
         return vector<Vertex<int>>{
                 {w, 0},
                 {0, 0},
@@ -73,7 +73,7 @@ class Scoreboard {
         };
     }
 
-    vector<Vertex<int>> number_6() {
+    vector<Vertex<int>> number_6() const {
         return vector<Vertex<int>>{
                 {w, 0},
                 {0, 0},
@@ -84,7 +84,7 @@ class Scoreboard {
         };
     }
 
-    vector<Vertex<int>> number_7() {
+    vector<Vertex<int>> number_7() const {
         return vector<Vertex<int>>{
                 {0,     0},
                 {w,     0},
@@ -92,7 +92,7 @@ class Scoreboard {
         };
     }
 
-    vector<Vertex<int>> number_8() {
+    vector<Vertex<int>> number_8() const {
         return vector<Vertex<int>>{
                 {w, 0},
                 {0, 0},
@@ -104,7 +104,7 @@ class Scoreboard {
         };
     }
 
-    vector<Vertex<int>> number_9() {
+    vector<Vertex<int>> number_9() const {
         return vector<Vertex<int>>{
                 {w, h},
                 {w, 0},
@@ -114,76 +114,117 @@ class Scoreboard {
         };
     }
 
-public:
+    /// @brief Точки ломаной, которой рисуется цифра num
+    vector<Vertex<int>> number(int num) const {
+        switch (num) {
+            case 0:
+                return number_0();
+            case 1:
+                return number_1();
+            case 2:
+                return number_2();
+            case 3:
+                return number_3();
+            case 4:
+                return number_4();
+            case 5:
+                return number_5();
+            case 6:
+                return number_6();
+            case 7:
+                return number_7();
+            case 8:
+                return number_8();
+            default:
+                return number_9();
+        }
+    }
 
-    Scoreboard() = default;
+    int glyph_w() const {
+        return w + 2;
+    }
 
-    /// @brief Отрисовка текущего счета
-    void draw_score(int score_) {
-        string score = to_string(score_);
-        for (int i = 0; i < score.size(); i++) {
-            int num = score[i] - '0';
-
-            Vertex<int> shift = {left_up.x + i * (w + skip), left_up.y};
-            vector<Vertex<int>> vec;
-            switch (num) {
-                case 0:
-                    vec = number_0();
-                    break;
-                case 1:
-                    vec = number_1();
-                    break;
-                case 2:
-                    vec = number_2();
-                    break;
-                case 3:
-                    vec = number_3();
-                    break;
-                case 4:
-                    vec = number_4();
-                    break;
-                case 5:
-                    vec = number_5();
-                    break;
-                case 6:
-                    vec = number_6();
-                    break;
-                case 7:
-                    vec = number_7();
-                    break;
-                case 8:
-                    vec = number_8();
-                    break;
-                case 9:
-                    vec = number_9();
-                    break;
-            }
+    int glyph_h() const {
+        return h + 2;
+    }
 
-            for (size_t j = 0; j < vec.size() - 1; j++) {
-                draw_line(shift + vec[j], shift + vec[j + 1], score_color);
-                draw_line(shift + Vertex{1, 0} + vec[j], shift + vec[j + 1] + Vertex{1, 0}, score_color);
-                draw_line(shift + Vertex{0, 1} + vec[j], shift + vec[j + 1] + Vertex{0, 1}, score_color);
+    /// @brief Растеризованные цифры с утолщенными линиями: 1 - пиксель цифры, glyph_w() x glyph_h() на цифру
+    vector<uint8_t> glyphs[10];
+
+    vector<uint32_t> widget; ///< Изображение табло целиком: рамка, фон и цифры
+    Rect widget_box = {0, 0, 0, 0}; ///< Где на экране лежит widget
+    int widget_score = -1; ///< Счет, для которого построен widget
+
+    void build_glyphs() {
+        for (int num = 0; num < 10; num++) {
+            auto &glyph = glyphs[num];
+            glyph.assign(size_t(glyph_w()) * glyph_h(), 0);
+            auto plot = [&](int x, int y) {
+                glyph[size_t(y) * glyph_w() + x] = 1;
+            };
+            auto vec = number(num);
+            // линия рисуется трижды со сдвигами, чтобы стать толще
+            for (size_t j = 0; j + 1 < vec.size(); j++) {
+                walk_line(vec[j].x, vec[j].y, vec[j + 1].x, vec[j + 1].y, plot);
+                walk_line(vec[j].x + 1, vec[j].y, vec[j + 1].x + 1, vec[j + 1].y, plot);
+                walk_line(vec[j].x, vec[j].y + 1, vec[j + 1].x, vec[j + 1].y + 1, plot);
             }
         }
+    }
+
+public:
+
+    Scoreboard() = default;
+
+    /// @brief Прямоугольник, который занимает табло со счетом score_ вместе с рамкой
+    Rect bounds(int score_) const {
+        int n = to_string(score_).size();
+        return {left_up.x - skip, left_up.y - skip, left_up.x + n * (w + skip) + 1, left_up.y + h + skip + 1};
+    }
+
+    /// @brief Подготовить изображение табло для счета score_
+    /// @details Табло строится из готовых цифр только при смене счета, отрисовка потом лишь копирует его в buffer.
+    void update(int score_) {
+        if (score_ == widget_score && !widget.empty())
+            return;
+        if (glyphs[0].empty())
+            build_glyphs();
+
+        widget_score = score_;
+        widget_box = bounds(score_);
+        const int bw = widget_box.x1 - widget_box.x0, bh = widget_box.y1 - widget_box.y0;
+        const uint32_t fg = to_pixel(score_color);
+        widget.assign(size_t(bw) * bh, to_pixel(score_background_color));
 
         // Рамка
-        int n = score.size();
-        Vertex<int> right_down = Vertex<int>{left_up.x + n * (w + skip), left_up.y + h + skip};
-        left_up -= Vertex<int>{skip, skip};
-        draw_line(left_up, {right_down.x, left_up.y}, score_color);
-        draw_line({right_down.x, left_up.y}, right_down, score_color);
-        draw_line(right_down, {left_up.x, right_down.y}, score_color);
-        draw_line({left_up.x, right_down.y}, left_up, score_color);
-
-        // Заливка
-        for(int y = left_up.y + 1; y < right_down.y; y++){
-            for(int x = left_up.x + 1; x < right_down.x; x++){
-                if(get_pixel(x, y) != score_color){
-                    set_pixel(x, y, score_background_color);
-                }
-            }
+        for (int x = 0; x < bw; x++)
+            widget[x] = widget[size_t(bh - 1) * bw + x] = fg;
+        for (int y = 0; y < bh; y++)
+            widget[size_t(y) * bw] = widget[size_t(y) * bw + bw - 1] = fg;
+
+        string score = to_string(score_);
+        for (int i = 0; i < int(score.size()); i++) {
+            const auto &glyph = glyphs[score[i] - '0'];
+            // левый верхний угол цифры относительно табло
+            const int gx = skip + i * (w + skip), gy = skip;
+            for (int y = 0; y < glyph_h(); y++)
+                for (int x = 0; x < glyph_w(); x++)
+                    if (glyph[size_t(y) * glyph_w() + x])
+                        widget[size_t(gy + y) * bw + gx + x] = fg;
         }
+    }
 
-        left_up += Vertex<int>{skip, skip};
+    /// @brief Отрисовка табло, подготовленного update(), отсеченного по clip_rect
+    void draw() const {
+        PROFILE_SCOPE("scoreboard");
+        Rect r = intersect(widget_box, clip_rect);
+        if (is_rect_empty(r))
+            return;
+
+        const int bw = widget_box.x1 - widget_box.x0;
+        auto &k = pixel_kernels();
+        for (int y = r.y0; y < r.y1; y++)
+            k.copy_span(buffer[y] + r.x0, &widget[size_t(y - widget_box.y0) * bw + (r.x0 - widget_box.x0)],
+                        size_t(r.x1 - r.x0));
     }
 };
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include "circle.h"
+#include "cube_launcher.h"
+
+/// @brief Неизменяемый снимок состояния игры, нужного для отрисовки кадра
+/// @details Отрисовка читает только снимок, поэтому симуляция следующего кадра может идти параллельно с ней.
+struct Snapshot {
+    vector<Circle> circles; ///< Круги
+    ShapePools shapes; ///< Кубы всех форм
+    int score = 0; ///< Счет
+    bool freeze = false; ///< Круги заморожены
+    unsigned long version = 0; ///< Версия состояния игры, см. GameLogic::get_version()
+    unsigned long game = 0; ///< Номер игры: меняется при перезапуске
+    double step = 0; ///< Длина шага act(), после которого сделан снимок, 0 - сцена стоит
+    double time = 0; ///< Время игры с запуска программы, с
+    Vertex<double> pivot; ///< Центр вращения кругов
+    double circles_w = 0; ///< Угловая скорость кругов на последнем шаге
+
+    /// @brief Вернуть кубы и круги на lag секунд назад по их скоростям
+    /// @details Движение внутри шага равномерное, поэтому это точная интерполяция между двумя последними шагами.
+    void rewind(double lag) {
+        shapes.for_each([&](auto &cubes, int) { cubes.move(-lag); });
+        double cos_phi, sin_phi;
+        small_angle_rotor(-circles_w * lag, cos_phi, sin_phi);
+        for (auto &circle: circles) {
+            auto vec = circle.center - pivot;
+            circle.center = pivot + Vertex<double>(vec.x * cos_phi - vec.y * sin_phi, vec.x * sin_phi + vec.y * cos_phi);
+        }
+    }
+
+    /// @brief Добавить прямоугольники кругов и кубов в отслеживание изменений
+    void add_damage(DamageTracker &damage) const {
+        for (auto &circle: circles)
+            damage.add(circle.bounds());
+        shapes.for_each([&](auto &cubes, int) {
+            for (size_t i = 0; i < cubes.size(); i++)
+                damage.add(cubes.bounds(i));
+        });
+    }
+
+    /// @brief Добавить круги в список элементов кадра
+    void add_circle_items(vector<DrawItem> &items) const {
+        const Color &color = freeze ? freeze_color : circle_color;
+        for (auto &circle: circles)
+            items.push_back({circle.bounds(), Circle::draw_item, &circle, color});
+    }
+
+    /// @brief Добавить кубы в список элементов кадра
+    void add_cube_items(vector<DrawItem> &items) const {
+        shapes.for_each([&](auto &cubes, int) {
+            using Pool = decay_t<decltype(cubes)>;
+            for (size_t i = 0; i < cubes.size(); i++)
+                items.push_back({cubes.bounds(i), Pool::draw_item, &cubes, get_cube_color(cubes.type(i)), i});
+        });
+    }
+};
+
+/// @brief Неблокирующая передача снимков от потока симуляции потоку отрисовки
+/// @details Двойная буферизация с запасным слотом: писатель заполняет свой слот и атомарно меняет его
+/// местами с готовым, читатель забирает готовый слот обменом со своим. Ни одна из сторон не ждет другую,
+/// а слот, который читается, никогда не перезаписывается.
+template<class T>
+class SnapshotBuffer {
+    static const unsigned index_mask = 3;
+    static const unsigned fresh_bit = 4; ///< В готовом слоте лежит еще не прочитанный снимок
+
+    T slots[3];
+    unsigned back = 0; ///< Слот писателя
+    atomic<unsigned> ready{1}; ///< Готовый слот и флаг fresh_bit
+    unsigned front = 2; ///< Слот читателя
+
+public:
+
+    SnapshotBuffer() = default;
+
+    /// @brief Слот, который заполняет писатель
+    T &write_slot() {
+        return slots[back];
+    }
+
+    /// @brief Опубликовать заполненный слот
+    void publish() {
+        back = ready.exchange(back | fresh_bit, memory_order_acq_rel) & index_mask;
+    }
+
+    /// @brief Забрать последний опубликованный снимок, если он новее текущего
+    /// @return true - если снимок обновился
+    bool acquire() {
+        if (!(ready.load(memory_order_acquire) & fresh_bit))
+            return false;
+        front = ready.exchange(front, memory_order_acq_rel) & index_mask;
+        return true;
+    }
+
+    /// @brief Снимок, который сейчас рисует читатель
+    const T &read_slot() const {
+        return slots[front];
+    }
+};
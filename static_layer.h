@@ -0,0 +1,59 @@
+#pragma once
+
+#include "circle.h"
+#include "color_settings.h"
+
+/// @brief Кэш неизменной за игру части кадра: фон, пунктир орбиты и границы
+/// @details Слой рисуется один раз и восстанавливается в buffer одним копированием за кадр.
+/// Перестраивается только при изменении параметров орбиты или цветов.
+class StaticLayer {
+    vector<uint32_t> pixels; ///< Копия кадра со статическими элементами
+    Vertex<double> center; ///< Центр орбиты, для которой построен слой
+    double r = -1; ///< Радиус орбиты
+    int dashes = 0; ///< Количество штрихов орбиты
+    uint32_t background = 0, ring = 0, bounds = 0; ///< Цвета, с которыми построен слой
+
+public:
+
+    StaticLayer() = default;
+
+    /// @brief Перестроить слой, если изменились орбита или цвета
+    /// @details Слой рисуется прямо в buffer, поэтому вызывать нужно до отрисовки кадра.
+    /// @return true - если слой был перестроен
+    bool update(const Circle &orbit, int dashes_count, const Color &background_col, const Color &ring_col) {
+        if (!pixels.empty() && orbit.center == center && orbit.r == r && dashes_count == dashes &&
+            to_pixel(background_col) == background && to_pixel(ring_col) == ring && to_pixel(bounds_color) == bounds)
+            return false;
+
+        center = orbit.center;
+        r = orbit.r;
+        dashes = dashes_count;
+        background = to_pixel(background_col);
+        ring = to_pixel(ring_col);
+        bounds = to_pixel(bounds_color);
+
+        fill_span(&buffer[0][0], SCREEN_HEIGHT * SCREEN_WIDTH, background);
+        orbit.draw_segment_line(ring_col, dashes);
+        draw_bounds();
+
+        pixels.assign(&buffer[0][0], &buffer[0][0] + SCREEN_HEIGHT * SCREEN_WIDTH);
+        return true;
+    }
+
+    /// @brief Восстановить слой в прямоугольнике r
+    void restore(const Rect &r) const {
+        PROFILE_SCOPE("restore_static");
+        Rect clipped = intersect(r, screen_rect);
+        if (is_rect_empty(clipped))
+            return;
+
+        copy_rect(clipped, pixels.data());
+    }
+
+    /// @brief Восстановить часть рамки, попадающую в прямоугольник r
+    /// @details Рамка рисуется поверх всего, поэтому перекрывает вылетающие из-за края кубы.
+    void restore_bounds(const Rect &r = screen_rect) const {
+        for (auto &strip: bounds_strips)
+            restore(intersect(strip, r));
+    }
+};
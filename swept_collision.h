@@ -0,0 +1,80 @@
+#pragma once
+
+#include "collision.h"
+#include "cube_pool.h"
+
+/// @brief Движение куба из N вершин на шаге: поступательное со скоростью u и вращение вокруг центра
+template<int N>
+struct SweptPolygon {
+    PolygonPoints<N> points; ///< Вершины в начале шага
+    Vertex<double> center; ///< Центр в начале шага
+    Vertex<double> u; ///< Скорость центра
+    double w; ///< Угловая скорость
+    double radius; ///< Радиус описанной окружности
+
+    /// @brief Вершины в момент t от начала шага
+    PolygonPoints<N> at(double t) const {
+        double cos_phi, sin_phi;
+        small_angle_rotor(w * t, cos_phi, sin_phi);
+        const Vertex<double> c = center + u * t;
+        PolygonPoints<N> res;
+        unroll<N>([&](int k) {
+            const double x = points[k].x - center.x, y = points[k].y - center.y;
+            res[k] = c + Vertex<double>(x * cos_phi - y * sin_phi, x * sin_phi + y * cos_phi);
+        });
+        return res;
+    }
+};
+
+using SweptCube = SweptPolygon<4>;
+
+/// @brief Движение круга на шаге: вращение вокруг точки pivot
+struct SweptCircle {
+    Vertex<double> center; ///< Центр в начале шага
+    double r; ///< Радиус
+    Vertex<double> pivot; ///< Центр вращения
+    double w; ///< Угловая скорость вращения
+
+    /// @brief Центр в момент t от начала шага
+    Vertex<double> at(double t) const {
+        double cos_phi, sin_phi;
+        small_angle_rotor(w * t, cos_phi, sin_phi);
+        const double x = center.x - pivot.x, y = center.y - pivot.y;
+        return pivot + Vertex<double>(x * cos_phi - y * sin_phi, x * sin_phi + y * cos_phi);
+    }
+
+    /// @brief Наибольшая скорость точек круга
+    double max_speed() const {
+        return fabs(w) * (center - pivot).mod();
+    }
+};
+
+/// @brief Момент первого касания куба и круга на шаге длиной dt
+/// @details Консервативное продвижение: расстояние между фигурами не может сократиться быстрее суммы
+/// наибольших скоростей их точек, поэтому шаг на расстояние / скорость не пропускает касание.
+/// Столкновение не теряется при любой длине шага, сколь угодно быстрый куб не проскакивает сквозь круг.
+/// @param tolerance Расстояние, на котором фигуры считаются коснувшимися
+/// @param max_iterations Ограничение числа шагов для касательных траекторий: на касательном сближении
+/// оценка скорости намного больше настоящей и расстояние сокращается медленно. Если шаги кончились,
+/// касание считается случившимся в достигнутый момент - лишнее касание лучше пропущенного
+/// @return Время касания из [0, dt] или отрицательное число, если касания нет
+template<int N>
+inline double time_of_impact(const SweptPolygon<N> &cube, const SweptCircle &circle, double dt,
+                             double tolerance = 1e-3, int max_iterations = 64) {
+    const double speed = cube.u.mod() + fabs(cube.w) * cube.radius + circle.max_speed();
+    double t = 0;
+    for (int i = 0; i < max_iterations; i++) {
+        const Vertex<double> c = circle.at(t);
+        const PolygonPoints<N> points = cube.at(t);
+        const double d = sqrt(polygon_distance2<N>(c.x, c.y, points)) - circle.r;
+        if (d <= tolerance)
+            return t;
+        if (speed <= 0)
+            return -1;
+
+        t += d / speed;
+        if (t > dt)
+            return -1;
+    }
+    return t;
+}
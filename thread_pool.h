@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "profiler.h"
+
+using namespace std;
+
+/// @brief Пул потоков для параллельного выполнения пронумерованных задач
+/// @details Вызывающий поток тоже выполняет задачи, поэтому пул из одного потока не создает рабочих потоков.
+class ThreadPool {
+    vector<thread> workers; ///< Рабочие потоки
+    mutex m;
+    condition_variable start_cv; ///< Сигнал о новой партии задач
+    condition_variable done_cv; ///< Сигнал о завершении партии
+    const function<void(size_t)> *task = nullptr; ///< Текущая задача
+    size_t count = 0; ///< Количество задач в партии
+    atomic<size_t> next{0}; ///< Номер следующей невыполненной задачи
+    size_t busy = 0; ///< Количество рабочих потоков, еще не закончивших партию
+    unsigned long batch = 0; ///< Номер партии
+    bool stop = false;
+
+    void work() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+            (*task)(i);
+    }
+
+    void worker_loop() {
+        PROFILE_THREAD("render worker");
+        unsigned long seen = 0;
+        unique_lock<mutex> lock(m);
+        for (;;) {
+            start_cv.wait(lock, [&] { return stop || batch != seen; });
+            if (stop)
+                return;
+            seen = batch;
+
+            lock.unlock();
+            work();
+            lock.lock();
+
+            if (--busy == 0)
+                done_cv.notify_one();
+        }
+    }
+
+public:
+
+    /// @param threads Общее количество потоков вместе с вызывающим
+    explicit ThreadPool(unsigned threads) {
+        for (unsigned i = 1; i < threads; i++)
+            workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// @brief Общее количество потоков вместе с вызывающим
+    size_t size() const {
+        return workers.size() + 1;
+    }
+
+    /// @brief Выполнить f(i) для всех i из [0, n) и дождаться завершения
+    void run(size_t n, const function<void(size_t)> &f) {
+        if (workers.empty() || n <= 1) {
+            for (size_t i = 0; i < n; i++)
+                f(i);
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(m);
+            task = &f;
+            count = n;
+            next = 0;
+            busy = workers.size();
+            batch++;
+        }
+        start_cv.notify_all();
+
+        work();
+
+        unique_lock<mutex> lock(m);
+        done_cv.wait(lock, [&] { return busy == 0; });
+        task = nullptr;
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        start_cv.notify_all();
+        for (auto &worker: workers)
+            worker.join();
+    }
+};
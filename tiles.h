@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdlib>
+#include <memory>
+#include "arena.h"
+#include "draw.h"
+#include "thread_pool.h"
+
+const int TILE_SIZE = 64; ///< Сторона тайла в пикселях: 16 КБ кадра помещаются в L1
+
+/// @brief Потайловая параллельная отрисовка кадра
+/// @details Кадр делится на тайлы, элементы раскладываются по тайлам по своим прямоугольникам
+/// с сохранением порядка. Тайлы рисуются параллельно, каждый поток отсекает примитивы по своему тайлу,
+/// поэтому разные потоки никогда не пишут в одни и те же пиксели.
+class TileRenderer {
+    static const int tiles_x = (SCREEN_WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+    static const int tiles_y = (SCREEN_HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+
+    unique_ptr<ThreadPool> pool;
+    FrameArena arena; ///< Память раскладки по тайлам, освобождается в начале каждого кадра
+    FrameVector<uint32_t> bin_start; ///< Элементы тайла t - bin_items[bin_start[t], bin_start[t + 1])
+    FrameVector<uint32_t> bin_items; ///< Номера элементов, упорядоченные по тайлам
+    FrameVector<int> active; ///< Тайлы, в которые попал хотя бы один элемент
+
+    /// @brief Количество потоков: GAME_THREADS или число ядер
+    static unsigned thread_count() {
+        if (const char *env = getenv("GAME_THREADS")) {
+            int n = atoi(env);
+            if (n > 0)
+                return unsigned(n);
+        }
+        return max(1u, thread::hardware_concurrency());
+    }
+
+    static Rect tile_rect(int tile) {
+        int x = tile % tiles_x * TILE_SIZE, y = tile / tiles_x * TILE_SIZE;
+        return intersect({x, y, x + TILE_SIZE, y + TILE_SIZE}, screen_rect);
+    }
+
+public:
+
+    TileRenderer() = default;
+
+    size_t threads() {
+        if (!pool)
+            pool = make_unique<ThreadPool>(thread_count());
+        return pool->size();
+    }
+
+    /// @brief Нарисовать элементы кадра в порядке следования
+    /// @details Раскладка по тайлам - сортировка подсчетом, массивы берутся из арены точного размера.
+    void render(const vector<DrawItem> &items) {
+        threads();
+        arena.reset();
+
+        auto for_each_tile = [&](size_t i, auto &&f) {
+            Rect box = intersect(items[i].bounds, screen_rect);
+            if (is_rect_empty(box))
+                return;
+            for (int ty = box.y0 / TILE_SIZE; ty <= (box.y1 - 1) / TILE_SIZE; ty++)
+                for (int tx = box.x0 / TILE_SIZE; tx <= (box.x1 - 1) / TILE_SIZE; tx++)
+                    f(ty * tiles_x + tx);
+        };
+
+        bin_start = FrameVector<uint32_t>(tiles_x * tiles_y + 1, 0, ArenaAllocator<uint32_t>(arena));
+        for (size_t i = 0; i < items.size(); i++)
+            for_each_tile(i, [&](int tile) { bin_start[tile]++; });
+        for (size_t t = 1; t < bin_start.size(); t++)
+            bin_start[t] += bin_start[t - 1];
+        // раскладка с конца сдвигает bin_start[t] от конца тайла к началу, сохраняя порядок элементов
+        bin_items = FrameVector<uint32_t>(bin_start.back(), 0, ArenaAllocator<uint32_t>(arena));
+        for (size_t i = items.size(); i-- > 0;)
+            for_each_tile(i, [&](int tile) { bin_items[--bin_start[tile]] = uint32_t(i); });
+
+        active = FrameVector<int>(ArenaAllocator<int>(arena));
+        active.reserve(tiles_x * tiles_y);
+        for (int tile = 0; tile < tiles_x * tiles_y; tile++)
+            if (bin_start[tile] != bin_start[tile + 1])
+                active.push_back(tile);
+
+        pool->run(active.size(), [&](size_t k) {
+            PROFILE_SCOPE("tile");
+            int tile = active[k];
+            Rect saved = clip_rect;
+            clip_rect = tile_rect(tile);
+            for (uint32_t b = bin_start[tile]; b < bin_start[tile + 1]; b++)
+                items[bin_items[b]].draw(items[bin_items[b]]);
+            clip_rect = saved;
+        });
+    }
+};
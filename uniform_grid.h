@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include "draw.h"
+
+/// @brief Равномерная сетка поверх экрана для поиска объектов рядом с заданной областью
+/// @details Каждый объект попадает ровно в одну ячейку - по своей точке привязки, поэтому запрос
+/// не возвращает объект дважды. Чтобы найти все объекты, пересекающие область, область нужно расширить
+/// на наибольший радиус объектов. Ячейки хранятся подряд (сортировка подсчетом), после первых кадров
+/// перестроение не выделяет память.
+class UniformGrid {
+    double cell = 1; ///< Сторона ячейки
+    int cols = 0, rows = 0;
+    vector<uint32_t> cell_start; ///< Объекты ячейки c - items[cell_start[c], cell_start[c + 1])
+    vector<uint32_t> items; ///< Номера объектов, упорядоченные по ячейкам
+    vector<uint32_t> item_cell; ///< Ячейка каждого объекта
+
+    int column(double x) const {
+        return max(0, min(cols - 1, int(floor(x / cell))));
+    }
+
+    int row(double y) const {
+        return max(0, min(rows - 1, int(floor(y / cell))));
+    }
+
+public:
+
+    UniformGrid() = default;
+
+    /// @brief Перестроить сетку
+    /// @param cell_size Сторона ячейки, обычно наибольший размер объектов
+    /// @param n Количество объектов
+    /// @param position Точка привязки объекта i: Vertex<double> position(size_t i)
+    template<class Position>
+    void build(double cell_size, size_t n, Position position) {
+        if (cell_size <= 0)
+            throw runtime_error("Cell size must be greater then zero");
+
+        cell = cell_size;
+        cols = max(1, int(ceil(SCREEN_WIDTH / cell)));
+        rows = max(1, int(ceil(SCREEN_HEIGHT / cell)));
+        cell_start.assign(size_t(cols) * rows + 1, 0);
+        item_cell.resize(n);
+        items.resize(n);
+
+        for (size_t i = 0; i < n; i++) {
+            Vertex<double> p = position(i);
+            item_cell[i] = uint32_t(row(p.y) * cols + column(p.x));
+            cell_start[item_cell[i]]++;
+        }
+        // после накопления cell_start[c] - конец ячейки c, раскладка сдвигает его к началу
+        for (size_t c = 1; c < cell_start.size(); c++)
+            cell_start[c] += cell_start[c - 1];
+        for (size_t i = n; i-- > 0;)
+            items[--cell_start[item_cell[i]]] = uint32_t(i);
+    }
+
+    /// @brief Вызвать f(i) для каждого объекта, точка привязки которого может лежать в области
+    /// @details Проверка идет с точностью до ячейки: f получает и объекты из соседних с областью точек ячеек.
+    template<class F>
+    void query(double x0, double y0, double x1, double y1, F &&f) const {
+        const int c0 = column(x0), c1 = column(x1);
+        const int r0 = row(y0), r1 = row(y1);
+        for (int r = r0; r <= r1; r++) {
+            const uint32_t *from = items.data() + cell_start[r * cols + c0];
+            const uint32_t *to = items.data() + cell_start[r * cols + c1 + 1];
+            for (; from != to; ++from)
+                f(size_t(*from));
+        }
+    }
+};
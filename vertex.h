@@ -2,12 +2,121 @@
 
 #include <iostream>
 #include <cmath>
+#include <type_traits>
 
 using namespace std;
 
+/// @brief Тип длины вектора с координатами T: сам T для float и double, double для целых
 template<typename T>
-class Vertex {
+using VertexReal = conditional_t<is_floating_point<T>::value, T, double>;
+
+/// @brief Точка или вектор размерности D с координатами типа T
+/// @details Игра двумерная и использует Vertex<T> = Vertex<T, 2> - только x и y, без лишней арифметики
+/// и памяти. Выравнивание на размер вектора позволяет загружать точку целиком в регистр SSE (double)
+/// или две точки (float). Трехмерная форма Vertex<T, 3> нужна для поворотов в пространстве.
+template<typename T, int D = 2>
+class Vertex;
+
+template<typename T>
+class alignas(2 * sizeof(T)) Vertex<T, 2> {
 public:
+    using real = VertexReal<T>;
+
+    T x = 0, y = 0;
+
+    Vertex() = default;
+
+    Vertex(T _x, T _y) : x(_x), y(_y) {}
+
+    Vertex operator+(const Vertex &a) const {
+        return Vertex(a.x + x, a.y + y);
+    }
+
+    Vertex operator+=(const Vertex &a) {
+        x += a.x;
+        y += a.y;
+        return *this;
+    }
+
+    Vertex operator-(const Vertex &a) const {
+        return Vertex(x - a.x, y - a.y);
+    }
+
+    Vertex operator-=(const Vertex &a) {
+        x -= a.x;
+        y -= a.y;
+        return *this;
+    }
+
+    [[nodiscard]] real mod() const {
+        return sqrt(real(x) * x + real(y) * y);
+    }
+
+    [[nodiscard]] T mod2() const {
+        return x * x + y * y;
+    }
+
+    bool operator==(const Vertex &a) const {
+        return a.x == x && a.y == y;
+    }
+
+    bool operator!=(const Vertex &a) const {
+        return !(*this == a);
+    }
+
+    void normalize() {
+        real len = mod();
+        if (len > 0.0) {
+            x /= len;
+            y /= len;
+        }
+    }
+
+    /// @brief Поворот на угол phi вокруг center
+    void rotate(double phi, const Vertex &center = {0, 0}) {
+        double cos_phi = cos(phi), sin_phi = sin(phi);
+        Vertex p = *this - center;
+        x = center.x + cos_phi * p.x - sin_phi * p.y;
+        y = center.y + sin_phi * p.x + cos_phi * p.y;
+    }
+
+    template<typename C>
+    Vertex operator*(const C &a) const {
+        return Vertex(x * a, y * a);
+    }
+
+    Vertex<int> multy(double c) const {
+        return Vertex<int>(int(round(c * x)), int(round(c * y)));
+    }
+
+    template<typename C>
+    Vertex operator/(const C &a) const {
+        return Vertex(x / a, y / a);
+    }
+
+    template<typename C>
+    Vertex operator/=(const C &a) {
+        x /= a;
+        y /= a;
+        return *this;
+    }
+
+    T operator*(const Vertex &a) const {
+        return a.x * x + a.y * y;
+    }
+
+    Vertex operator-() const {
+        return Vertex(-x, -y);
+    }
+
+    ~Vertex() = default;
+};
+
+template<typename T>
+class Vertex<T, 3> {
+public:
+    using real = VertexReal<T>;
+
     T x = 0, y = 0, z = 0;
 
     Vertex() = default;
@@ -16,6 +125,8 @@ public:
 
     Vertex(T _x, T _y, T _z) : x(_x), y(_y), z(_z) {}
 
+    explicit Vertex(const Vertex<T, 2> &a) : x(a.x), y(a.y), z(0) {}
+
     Vertex operator+(const Vertex &a) const {
         return Vertex(a.x + x, a.y + y, a.z + z);
     }
@@ -38,8 +149,8 @@ public:
         return *this;
     }
 
-    [[nodiscard]] double mod() const {
-        return sqrt(x * x + y * y + z * z);
+    [[nodiscard]] real mod() const {
+        return sqrt(real(x) * x + real(y) * y + real(z) * z);
     }
 
     [[nodiscard]] T mod2() const {
@@ -47,21 +158,15 @@ public:
     }
 
     bool operator==(const Vertex &a) const {
-        if (a.x != x || a.y != y || a.z != z)
-            return false;
-        else
-            return true;
+        return a.x == x && a.y == y && a.z == z;
     }
 
     bool operator!=(const Vertex &a) const {
-        if (a.x != x || a.y != y || a.z != z)
-            return true;
-        else
-            return false;
+        return !(*this == a);
     }
 
     void normalize() {
-        T len = mod();
+        real len = mod();
         if (len > 0.0) {
             x /= len;
             y /= len;
@@ -69,11 +174,11 @@ public:
         }
     }
 
-    void rotate(double alpha, double betta, double gamma, const Vertex<T> &center = {0, 0, 0}) {
+    void rotate(double alpha, double betta, double gamma, const Vertex &center = {0, 0, 0}) {
         double cos_a = cos(alpha), sin_a = sin(alpha);
         double cos_b = cos(betta), sin_b = sin(betta);
         double cos_g = cos(gamma), sin_g = sin(gamma);
-        Vertex<T> p = *this - center;
+        Vertex p = *this - center;
         x = center.x + cos_b * cos_g * p.x - sin_g * cos_b * p.y + sin_b * p.z;
         y = center.y + (sin_a * sin_b * cos_g + sin_g * cos_a) * p.x +
             (-sin_a * sin_b * sin_g + cos_a * cos_g) * p.y - sin_a * cos_b * p.z;
@@ -99,8 +204,8 @@ public:
         return Vertex(x * a, y * a, z * a);
     }
 
-    Vertex<int> multy(double c) const {
-        return Vertex(int(round(c * x)), int(round(c * y)), int(round(c * z)));
+    Vertex<int, 3> multy(double c) const {
+        return Vertex<int, 3>(int(round(c * x)), int(round(c * y)), int(round(c * z)));
     }
 
     template<typename C>
@@ -124,48 +229,79 @@ public:
         return Vertex(-x, -y, -z);
     }
 
+    /// @brief Проекция на плоскость xy
+    Vertex<T, 2> xy() const {
+        return Vertex<T, 2>(x, y);
+    }
+
     ~Vertex() = default;
 };
 
 template<typename T>
-inline Vertex<T> cross(const Vertex<T> &a, const Vertex<T> &b) {
-    return Vertex(a.y * b.z - a.z * b.y, -a.x * b.z + a.z * b.x, a.x * b.y - a.y * b.x);
+Vertex(T, T) -> Vertex<T, 2>;
+
+template<typename T>
+Vertex(T, T, T) -> Vertex<T, 3>;
+
+template<typename T>
+using Vertex3 = Vertex<T, 3>;
+
+template<typename T>
+inline Vertex<T, 3> cross(const Vertex<T, 3> &a, const Vertex<T, 3> &b) {
+    return Vertex<T, 3>(a.y * b.z - a.z * b.y, -a.x * b.z + a.z * b.x, a.x * b.y - a.y * b.x);
 }
 
 template<typename T>
-inline Vertex<T> scalar(const Vertex<T> &a, const Vertex<T> &b) {
-    return Vertex(a.x * b.x, a.y * b.y, a.z * b.z);
+inline Vertex<T, 2> scalar(const Vertex<T, 2> &a, const Vertex<T, 2> &b) {
+    return Vertex<T, 2>(a.x * b.x, a.y * b.y);
 }
 
 template<typename T>
-inline T area(const Vertex<T> &a, const Vertex<T> &b) {
+inline Vertex<T, 3> scalar(const Vertex<T, 3> &a, const Vertex<T, 3> &b) {
+    return Vertex<T, 3>(a.x * b.x, a.y * b.y, a.z * b.z);
+}
+
+/// @brief Векторное произведение на плоскости: ориентированная площадь параллелограмма
+template<typename T, int D>
+inline T area(const Vertex<T, D> &a, const Vertex<T, D> &b) {
     return a.x * b.y - a.y * b.x;
 }
 
 template<typename T>
-inline std::ostream &operator<<(std::ostream &os, const Vertex<T> &a) {
-    os << a.x << " " << a.y << " " << a.z;
+inline std::ostream &operator<<(std::ostream &os, const Vertex<T, 2> &a) {
+    os << a.x << " " << a.y;
     return os;
 }
 
 template<typename T>
-inline T dist(const Vertex<T> &a, const Vertex<T> &b) {
+inline std::ostream &operator<<(std::ostream &os, const Vertex<T, 3> &a) {
+    os << a.x << " " << a.y << " " << a.z;
+    return os;
+}
+
+template<typename T, int D>
+inline VertexReal<T> dist(const Vertex<T, D> &a, const Vertex<T, D> &b) {
     return (b - a).mod();
 }
 
 template<typename T>
-inline bool equal(const Vertex<T> &a, const Vertex<T> &b, T eps = 0.0) {
+inline bool equal(const Vertex<T, 2> &a, const Vertex<T, 2> &b, T eps = 0.0) {
+    return abs(a.x - b.x) < eps && abs(a.y - b.y) < eps;
+}
+
+template<typename T>
+inline bool equal(const Vertex<T, 3> &a, const Vertex<T, 3> &b, T eps = 0.0) {
     return abs(a.x - b.x) < eps && abs(a.y - b.y) < eps && abs(a.z - b.z) < eps;
 }
 
-Vertex<double> to_double_point(const Vertex<int> &a) {
-    return Vertex<double>{(double) a.x, (double) a.y, (double) a.z};
+inline Vertex<double> to_double_point(const Vertex<int> &a) {
+    return Vertex<double>{(double) a.x, (double) a.y};
 }
 
-Vertex<int> to_int_point(const Vertex<double> &a) {
-    return Vertex<int>{int(round((a.x))), int(round((a.y))), int(round((a.z)))};
+inline Vertex<int> to_int_point(const Vertex<double> &a) {
+    return Vertex<int>{int(round((a.x))), int(round((a.y)))};
 }
 
-int round_to_int(double x) {
+inline int round_to_int(double x) {
     return int(round(x));
 }
\ No newline at end of file